@@ -42,6 +42,84 @@
 #define ARM_MODE_5_IS_OPTION	0x40	//is value option (as opposed to offset)
 #define ARM_MODE_5_RR		0x80	//MCRR or MRCC instrs
 
+#ifdef ARM_THREADED
+
+	//instr classes by bits 27..20 and 7..4, each is a label in cpuPrvExecInstr()
+	#define ARM_CLS_DP		0	//data processing
+	#define ARM_CLS_MUL_SWP		1
+	#define ARM_CLS_LDST_EXTRA	2	//halfword, signed byte, doubleword
+	#define ARM_CLS_MISC		3	//MRS/MSR reg, BX, CLZ, DSP
+	#define ARM_CLS_MSR_IMM		4	//MSR imm, hints, MOVW/MOVT
+	#define ARM_CLS_LDST		5
+	#define ARM_CLS_MEDIA		6
+	#define ARM_CLS_LDM_STM		7
+	#define ARM_CLS_BRANCH		8
+	#define ARM_CLS_CP_MEM		9
+	#define ARM_CLS_CP_REG		10
+	#define ARM_CLS_SWI		11
+
+	#define ARM_DISPATCH_TARGET(name)	name:
+
+	static UInt8 cpuPrvArmClass[4096];
+	
+#else
+
+	#define ARM_DISPATCH_TARGET(name)
+
+#endif
+
+#ifdef ARM_HOT_FORMS
+
+	//forms with their own handlers, by the same index as ARM_CLS_*. all are for cond == AL in ARM state
+	#define ARM_HOT_NONE		0
+	#define ARM_HOT_MOV_IMM		1
+	#define ARM_HOT_MOV_REG		2	//register forms are unshifted only
+	#define ARM_HOT_ADD_IMM		3
+	#define ARM_HOT_ADD_REG		4
+	#define ARM_HOT_ADDS_IMM	5
+	#define ARM_HOT_ADDS_REG	6
+	#define ARM_HOT_SUB_IMM		7
+	#define ARM_HOT_SUB_REG		8
+	#define ARM_HOT_SUBS_IMM	9
+	#define ARM_HOT_SUBS_REG	10
+	#define ARM_HOT_CMP_IMM		11
+	#define ARM_HOT_CMP_REG		12
+	#define ARM_HOT_LDR		13	//LDR/STR[B] imm offset: pre-indexed, pre-indexed with writeback, post-indexed
+	#define ARM_HOT_LDR_W		14
+	#define ARM_HOT_LDR_POST	15
+	#define ARM_HOT_LDRB		16
+	#define ARM_HOT_LDRB_W		17
+	#define ARM_HOT_LDRB_POST	18
+	#define ARM_HOT_STR		19
+	#define ARM_HOT_STR_W		20
+	#define ARM_HOT_STR_POST	21
+	#define ARM_HOT_STRB		22
+	#define ARM_HOT_STRB_W		23
+	#define ARM_HOT_STRB_POST	24
+	#define ARM_HOT_B		25
+	#define ARM_HOT_BL		26
+	#define ARM_HOT_MUL		27
+	#define ARM_HOT_MULS		28
+	#define ARM_HOT_MLA		29
+	#define ARM_HOT_MLAS		30
+	#define ARM_HOT_UMULL		31
+	#define ARM_HOT_UMULLS		32
+	#define ARM_HOT_UMLAL		33
+	#define ARM_HOT_UMLALS		34
+	#define ARM_HOT_SMULL		35
+	#define ARM_HOT_SMULLS		36
+	#define ARM_HOT_SMLAL		37
+	#define ARM_HOT_SMLALS		38
+	
+	#define ARM_HOT_ALU_MOV		0
+	#define ARM_HOT_ALU_ADD		1
+	#define ARM_HOT_ALU_SUB		2
+	#define ARM_HOT_ALU_CMP		3
+
+	static UInt8 cpuPrvArmHotForm[4096];
+
+#endif
+
 #ifdef ARM_V6
 
 	#define ARM_CPSR_UND_AND	(~(ARM_SR_M | ARM_SR_E | ARM_SR_T))
@@ -95,6 +173,91 @@ static _INLINE_ UInt32 cpuPrvROR(UInt32 val, UInt8 ror){
 	return val;
 }
 
+#ifdef ARM_BRANCH_CACHE
+
+	static void cpuPrvFetchFlush(ArmCpu* cpu){
+		
+		UInt8 i;
+		
+		cpu->fetch.va = ARM_FETCH_NONE;
+		for(i = 0; i < ARM_BTC_SZ; i++) cpu->btc[i].va = ARM_FETCH_NONE;
+		cpu->rasNum = 0;
+	}
+	
+	static void cpuPrvFetchPageChange(ArmCpu* cpu, UInt32 va, UInt32 key){	//key is va's page | ARM_FETCH_PRIV as needed
+		
+		ArmFetchPage* e;
+		const UInt32* p;
+		UInt32 find = va | (key & ARM_FETCH_PRIV);
+		UInt8 i, j;
+		
+		for(i = 0, j = cpu->rasTop; i < cpu->rasNum; i++){	//newest first, entries above a hit are calls that returned within their page
+			
+			j = (j - 1) & (ARM_RAS_SZ - 1);
+			if(cpu->ras[j].va == find){
+				
+				cpu->rasTop = j;
+				cpu->rasNum -= i + 1;
+				cpu->fetch.va = key;
+				cpu->fetch.ptr = cpu->ras[j].ptr;
+				cpu->rasHits++;
+				return;
+			}
+		}
+		
+		e = &cpu->btc[(va / ARM_FETCH_PAGE) & (ARM_BTC_SZ - 1)];
+		if(e->va == key) cpu->btcHits++;
+		else{
+			
+			p = NULL;
+			va -= va % ARM_FETCH_PAGE;
+			if(cpu->ptrF && (p = cpu->ptrF(cpu, va, 4, false, (key & ARM_FETCH_PRIV) != 0))){		//both ends, in case RAM ends inside this page
+				
+				if(cpu->ptrF(cpu, va + ARM_FETCH_PAGE - 4, 4, false, (key & ARM_FETCH_PRIV) != 0) != p + ARM_FETCH_PAGE / 4 - 1) p = NULL;
+			}
+			e->va = key;
+			e->ptr = p;
+			cpu->btcMisses++;
+		}
+		cpu->fetch = *e;
+	}
+
+#endif
+
+static _INLINE_ Boolean cpuPrvFetch(ArmCpu* cpu, UInt32 va, UInt8 sz, Boolean privileged, UInt8* fsrP, void* buf){
+
+#ifdef ARM_BRANCH_CACHE
+	UInt32 key = (va - va % ARM_FETCH_PAGE) | (privileged ? ARM_FETCH_PRIV : 0);
+	const UInt8* p;
+	
+	if(key != cpu->fetch.va) cpuPrvFetchPageChange(cpu, va, key);
+	if(cpu->fetch.ptr){
+		
+		p = (const UInt8*)cpu->fetch.ptr + va % ARM_FETCH_PAGE;
+		if(sz == 4) *(UInt32*)buf = *(const UInt32*)p;
+		else *(UInt16*)buf = *(const UInt16*)p;
+		return true;
+	}
+#endif
+	return icacheFetch(&cpu->ic, va, sz, privileged, fsrP, buf);
+}
+
+static _INLINE_ void cpuPrvCallMade(_UNUSED_ ArmCpu* cpu, _UNUSED_ UInt32 ret){	//remember where the return will land
+
+#ifdef ARM_BRANCH_CACHE
+	ArmFetchPage* e;
+	
+	ret &=~ 1UL;
+	if((ret - ret % ARM_FETCH_PAGE) != (cpu->fetch.va &~ ARM_FETCH_PRIV)) return;	//call was the last thing in its page, not worth it
+	
+	e = &cpu->ras[cpu->rasTop];
+	e->va = ret | (cpu->fetch.va & ARM_FETCH_PRIV);
+	e->ptr = cpu->fetch.ptr;
+	cpu->rasTop = (cpu->rasTop + 1) & (ARM_RAS_SZ - 1);
+	if(cpu->rasNum < ARM_RAS_SZ) cpu->rasNum++;
+#endif
+}
+
 static _INLINE_ void cpuPrvSetPC(ArmCpu* cpu, UInt32 pc){
 	cpu->regs[15] = pc &~ 1UL;
 	cpu->CPSR &=~ ARM_SR_T;
@@ -1249,6 +1412,25 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 		UInt32 m32, x32;	//non-register 32-bit val
 		UInt16 v16;
 		UInt8 va8, vb8 = 0, vc8;
+		
+	#ifdef ARM_THREADED
+		static const void* const targets[] = {
+			[ARM_CLS_DP] = &&data_processing,
+			[ARM_CLS_MUL_SWP] = &&arm_mul_swp,
+			[ARM_CLS_LDST_EXTRA] = &&arm_ldst_extra,
+			[ARM_CLS_MISC] = &&arm_misc,
+			[ARM_CLS_MSR_IMM] = &&arm_msr_imm,
+			[ARM_CLS_LDST] = &&load_store_mode_2,
+			[ARM_CLS_MEDIA] = &&arm_media,
+			[ARM_CLS_LDM_STM] = &&arm_ldm_stm,
+			[ARM_CLS_BRANCH] = &&arm_branch,
+			[ARM_CLS_CP_MEM] = &&arm_cp_mem,
+			[ARM_CLS_CP_REG] = &&arm_cp_reg,
+			[ARM_CLS_SWI] = &&arm_swi,
+		};
+		
+		if(!specialInstr) goto *targets[cpuPrvArmClass[((instr >> 16) & 0x0FF0) | ((instr >> 4) & 0x0F)]];	//the unconditional space is rare, it takes the switch
+	#endif
 
 		switch((instr >> 24) & 0x0F){
 
@@ -1260,6 +1442,7 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 
 					if((instr & 0x00000060UL) == 0x00000000){	//swp[b], mult(acc), mult(acc) long
 						
+		ARM_DISPATCH_TARGET(arm_mul_swp)
 						if(instr & 0x01000000UL){		//SWB/SWPB
 							
 							switch((instr >> 20) & 0x0F){
@@ -1450,9 +1633,14 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 					}
 					else{	//load/store signed/unsigned byte/halfword/two_words
 					
-						UInt32 store[2] = {0,0};
-						UInt8* store8 = (UInt8*)store;
-						UInt16* store16 = (UInt16*)store;
+						UInt32 store[2];
+						UInt8* store8;
+						UInt16* store16;
+						
+		ARM_DISPATCH_TARGET(arm_ldst_extra)
+						store[0] = store[1] = 0;
+						store8 = (UInt8*)store;
+						store16 = (UInt16*)store;
 						
 						va8 = cpuPrvArmAdrMode_3(cpu, instr, &m32, &x32, wasT, specialPC);
 						tmp = m32;
@@ -1525,6 +1713,7 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 				}
 				else if((instr & 0x01900000UL) == 0x01000000UL){	//misc instrs (table 3.3)
 						
+		ARM_DISPATCH_TARGET(arm_misc)
 					tmp = (instr >> 4) & 0x0F;
 					
 					switch(tmp){
@@ -1557,7 +1746,11 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 								
 								if((instr & 0x0FFFFF00UL) != 0x012FFF00UL) goto invalid_instr;
 								
-								if((instr & 0x00000030UL) == 0x00000030UL) cpuPrvSetReg(cpu, 14, instrPC + (wasT ? 3 : 4));	//save return value for BLX
+								if((instr & 0x00000030UL) == 0x00000030UL){	//save return value for BLX
+									
+									cpuPrvSetReg(cpu, 14, instrPC + (wasT ? 3 : 4));
+									cpuPrvCallMade(cpu, cpu->regs[14]);
+								}
 								cpuPrvSetPC(cpu, cpuPrvGetReg(cpu, instr & 0x0F, wasT, specialPC));
 							}
 							goto instr_done;
@@ -1683,14 +1876,10 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 									else adr &= 0xFFFFUL;
 									if(adr & 0x8000UL) adr |= 0xFFFF0000UL;
 									
-									adr *= tmp;
-									if(adr & 0x80000000UL) va8 |= 1;	//neg
-									tmp = cpuPrvGetReg(cpu, (instr >> 12) & 0x0F, wasT, specialPC);	//RdLo
-									if((tmp + adr) < tmp) va8 |= 2; //carry
-									cpuPrvSetReg(cpu, (instr >> 12) & 0x0F, tmp);
-									v32 = cpuPrvGetReg(cpu, (instr >> 16) & 0x0F, wasT, specialPC);	//RdHi
-									if(va8 & 2) v32++;
-									if(va8 & 1) v32--;
+									v64 = u64_from_halves(cpuPrvGetReg(cpu, (instr >> 16) & 0x0F, wasT, specialPC), cpuPrvGetReg(cpu, (instr >> 12) & 0x0F, wasT, specialPC));
+									v64 = u64_add(v64, u64_xtnd32(u64_32_to_64(adr * tmp)));	//RdHi:RdLo += sign-extended 16x16 product
+									cpuPrvSetReg(cpu, (instr >> 12) & 0x0F, u64_64_to_32(v64));
+									v32 = u64_get_hi(v64);
 									break;
 									
 								case 3:			//SMULxy
@@ -1732,6 +1921,7 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 				
 				if((instr & 0x01900000UL) == 0x01000000UL){	//all NON-data-processing instrs in this space are here
 					
+		ARM_DISPATCH_TARGET(arm_msr_imm)
 					if(instr & 0x00200000UL){		//MSR imm and hints
 						
 						if((instr & 0x00400000UL) || (instr & 0x000F0000UL)){	//move imm to PSR
@@ -1977,6 +2167,7 @@ data_processing:							//data processing
 
 				if(instr & 0x00000010UL){		//media and undefined instrs
 		
+		ARM_DISPATCH_TARGET(arm_media)
 		#ifdef ARM_V6
 					if(cpuPrvMediaInstrs(cpu, instr, wasT, specialPC)) goto instr_done;	
 		#endif		
@@ -2039,6 +2230,7 @@ load_store_mode_2:
 
 				if(specialInstr) goto invalid_instr;
 
+		ARM_DISPATCH_TARGET(arm_ldm_stm)
 				va8 = cpuPrvArmAdrMode_4(cpu, instr, &v16);
 				if((va8 & ARM_MODE_4_S) && usesUsrRegs) goto invalid_instr;	//no S mode please in modes with no baked regs //or SPSR
 				L = (instr & 0x00100000UL) != 0;
@@ -2046,6 +2238,38 @@ load_store_mode_2:
 				
 				specialInstr = L && (va8 & ARM_MODE_4_S) && (v16 & 0x8000UL) && !usesUsrRegs;	//specialInstr = "copyCPSR"
 				
+			#ifndef EMBEDDED	//on AVR the word loop costs the same SD traffic and no 64-byte stack buffer
+				if(!(va8 & ARM_MODE_4_S)){	//try the whole transfer as one burst: one translation, one callback
+					
+					UInt32 burst[16], lo, *p;
+					UInt8 n = 0, i;
+					
+					for(i = 0; i < 16; i++) if(v16 & (1UL << i)) n++;
+					lo = (va8 & ARM_MODE_4_INC) ? adr : adr - 4 * n;
+					if(!(va8 & ARM_MODE_4_BFR) == !(va8 & ARM_MODE_4_INC)) lo += 4;	//IB and DA
+					
+					if(cpu->ptrF && n && !(lo & 3) && (p = cpu->ptrF(cpu, lo, n * 4, !L, privileged))){	//plain RAM: registers straight to/from it
+						
+						if(L) for(i = 0; i < 16; i++){ if(v16 & (1UL << i)) cpu->regs[i] = *p++; }
+						else for(i = 0; i < 16; i++){ if(v16 & (1UL << i)) *p++ = cpuPrvGetReg(cpu, i, wasT, specialPC); }
+						adr = (va8 & ARM_MODE_4_INC) ? adr + 4 * n : adr - 4 * n;
+						goto load_store_mode_4_done;
+					}
+					if(n > 2 || (n == 2 && !(lo & 7))){	//memF keeps natural alignment rules for 8 bytes and less
+						
+						if(!L) for(i = 0, n = 0; i < 16; i++) if(v16 & (1UL << i)) burst[n++] = cpuPrvGetReg(cpu, i, wasT, specialPC);
+						
+						if(cpu->memF(cpu, burst, lo, n * 4, !L, privileged, &fsr)){
+							
+							if(L) for(i = 0, n = 0; i < 16; i++) if(v16 & (1UL << i)) cpu->regs[i] = burst[n++];
+							adr = (va8 & ARM_MODE_4_INC) ? adr + 4 * n : adr - 4 * n;
+							goto load_store_mode_4_done;
+						}
+						//else: not one page/region, or a fault. the word loop sorts out which word faulted
+					}
+				}
+			#endif
+				
 				for(vc8 = 0; vc8 < 16; vc8++){
 
 					vb8 = (va8 & ARM_MODE_4_INC) ? vc8 : 15 - vc8;
@@ -2112,6 +2336,9 @@ load_store_mode_2:
 						if(!(va8 & ARM_MODE_4_BFR)) adr += (va8 & ARM_MODE_4_INC) ? 4L : -4L;
 					}
 				}
+			#ifndef EMBEDDED
+load_store_mode_4_done:
+			#endif
 				if(va8 & ARM_MODE_4_WBK){
 					cpuPrvSetReg(cpu, va8 & ARM_MODE_4_REG, adr);
 				}
@@ -2136,6 +2363,7 @@ load_store_mode_2:
 			case 10:
 			case 11:	//B/BL/BLX(if cond=0b1111)
 
+		ARM_DISPATCH_TARGET(arm_branch)
 				tmp = instr & 0x00FFFFFFUL;			//get offset
 				if(tmp & 0x00800000UL) tmp |= 0xFF000000UL;	//sign extend
 				tmp = tmp << (wasT ? 1 : 2);			//shift left 2(ARM) or 1(thumb)
@@ -2143,11 +2371,17 @@ load_store_mode_2:
 				if(specialInstr){				//handle BLX
 					if(instr & 0x01000000UL) tmp += 2;
 					cpu->regs[14] = instrPC + (wasT ? 2 : 4);
+					cpuPrvCallMade(cpu, cpu->regs[14]);
 					if(!(cpu->CPSR & ARM_SR_T)) tmp |= 1UL;	//set T flag if needed
 				}
 				else{						//not BLX -> differentiate between BL and B
-					if(instr & 0x01000000UL) cpu->regs[14] = instrPC + (wasT ? 2 : 4);
+					if(instr & 0x01000000UL){
+						
+						cpu->regs[14] = instrPC + (wasT ? 2 : 4);
+						cpuPrvCallMade(cpu, cpu->regs[14]);
+					}
 					if(cpu->CPSR & ARM_SR_T) tmp |= 1UL;	//keep T flag as needed
+					if((tmp &~ 1UL) == instrPC && !(instr & 0x01000000UL) && !(cpu->CPSR & ARM_SR_I)) cpuSleep(cpu);	//B to self with irqs on: idle loop, only an irq gets us out
 				}
 				cpuPrvSetPC(cpu, tmp);
 				goto instr_done;
@@ -2155,6 +2389,7 @@ load_store_mode_2:
 			case 12:
 			case 13:	//coprocessor load/store and double register transfers
 
+		ARM_DISPATCH_TARGET(arm_cp_mem)
 				va8 = cpuPrvArmAdrMode_5(cpu, instr, &m32);
 				v32 = m32;
 				vb8 = (instr >> 8) & 0x0F;
@@ -2175,13 +2410,15 @@ load_store_mode_2:
 					tmp += v32;
 					
 					if(!cpu->coproc[vb8].memAccess) goto invalid_instr;
-					if(!cpu->coproc[vb8].memAccess(cpu, cpu->coproc[vb8].userData, specialInstr, (instr & 0x00400000UL) !=0, !(instr & 0x00100000UL), (instr >> 12) & 0x0F, (va8 & ARM_MODE_5_ADD_BEFORE) ? tmp : adr, (va8 & ARM_MODE_5_IS_OPTION) ? &vc8 : NULL)) goto invalid_instr;
-					if(va8 & ARM_MODE_5_ADD_AFTER) cpuPrvSetReg(cpu, va8 & ARM_MODE_5_REG, tmp);
+					cpu->coprocAbort = false;
+					if(!cpu->coproc[vb8].memAccess(cpu, cpu->coproc[vb8].userData, specialInstr, (instr & 0x00400000UL) !=0, !(instr & 0x00100000UL), (instr >> 12) & 0x0F, (va8 & ARM_MODE_5_ADD_BEFORE) ? tmp : adr, (va8 & ARM_MODE_5_IS_OPTION) ? &vc8 : NULL, (va8 & ARM_MODE_5_ADD_AFTER) ? instr & 0xFF : 0, ((instr >> 22) & (ARM_CP_ADR_P | ARM_CP_ADR_U)) | ((instr >> 21) & ARM_CP_ADR_W))) goto invalid_instr;
+					if((va8 & ARM_MODE_5_ADD_AFTER) && !cpu->coprocAbort) cpuPrvSetReg(cpu, va8 & ARM_MODE_5_REG, tmp);	//base is left alone on an abort
 				}
 				goto instr_done;
 
 			case 14:	//coprocessor data processing and register transfers
 
+		ARM_DISPATCH_TARGET(arm_cp_reg)
 				vb8 = (instr >> 8) & 0x0F;
 				
 				if(vb8 >= 14){						//cp14 and cp15 are for priviledged users only
@@ -2204,7 +2441,8 @@ load_store_mode_2:
 			case 15:	//SWI
 
 				if(specialInstr) goto invalid_instr;
-
+				
+		ARM_DISPATCH_TARGET(arm_swi)
 				cpuPrvException(cpu, cpu->vectorBase + ARM_VECTOR_OFFT_SWI, instrPC + (wasT ? 2 : 4), ARM_CPSR_SWI_ORR | (cpu->CPSR & ARM_CPSR_SWI_AND));
 				goto instr_done;
 		}
@@ -2230,6 +2468,196 @@ load_store_mode_2:
 	return errNone;
 }
 
+#ifdef ARM_HOT_FORMS
+
+	//the hot handlers: always inlined with constant flags, so each form gets its own straight-line copy
+	
+	static _INLINE_ Boolean cpuPrvArmHotAlu(ArmCpu* cpu, UInt32 instr, Boolean imm, Boolean S, UInt8 op){
+		
+		UInt8 rd = (instr >> 12) & 0x0F, rn = (instr >> 16) & 0x0F;
+		UInt32 a, b, res, sr;
+		Boolean C = false, V = false;
+		
+		if(imm) b = cpuPrvROR(instr & 0xFF, (instr >> 7) & 0x1E);
+		else{
+			if((instr & 0x00000F00UL) || (instr & 0x0F) == 15) return false;	//shifted or PC
+			b = cpu->regs[instr & 0x0F];
+		}
+		if(op != ARM_HOT_ALU_CMP && rd == 15) return false;
+		if(op != ARM_HOT_ALU_MOV && rn == 15) return false;
+		a = cpu->regs[rn];
+		
+		switch(op){
+			
+			case ARM_HOT_ALU_MOV:
+				res = b;
+				break;
+			
+			case ARM_HOT_ALU_ADD:
+				res = a + b;
+				C = res < a;
+				V = cpuPrvSignedAdditionOverflows(a, b, res);
+				break;
+			
+			default:
+				res = a - b;
+				C = a >= b;
+				V = cpuPrvSignedSubtractionOverflows(a, b, res);
+				break;
+		}
+		
+		if(op != ARM_HOT_ALU_CMP) cpu->regs[rd] = res;
+		if(S || op == ARM_HOT_ALU_CMP){
+			
+			sr = cpu->CPSR &~ (ARM_SR_Z | ARM_SR_N | ARM_SR_C | ARM_SR_V);
+			if(!res) sr |= ARM_SR_Z;
+			if(res & 0x80000000UL) sr |= ARM_SR_N;
+			if(C) sr |= ARM_SR_C;
+			if(V) sr |= ARM_SR_V;
+			cpu->CPSR = sr;
+		}
+		return true;
+	}
+	
+	static _INLINE_ Boolean cpuPrvArmHotLdSt(ArmCpu* cpu, UInt32 instr, Boolean privileged, Boolean L, Boolean B, Boolean P, Boolean W){
+		
+		UInt8 rd = (instr >> 12) & 0x0F, rn = (instr >> 16) & 0x0F, sz = B ? 1 : 4, fsr, v8;
+		UInt32 adr, ea, off, v32;
+		Boolean ok;
+		
+		if(rd == 15 || rn == 15) return false;
+		
+		off = instr & 0x0FFFUL;
+		if(!(instr & 0x00800000UL)) off = -off;
+		adr = cpu->regs[rn];
+		ea = P ? adr + off : adr;
+		
+		if(L){
+			
+			ok = B ? cpu->memF(cpu, &v8, ea, 1, false, privileged, &fsr) : cpu->memF(cpu, &v32, ea, 4, false, privileged, &fsr);
+			if(!ok){
+				cpuPrvHandleMemErr(cpu, ea, sz, false, false, fsr);
+				return true;
+			}
+			cpu->regs[rd] = B ? v8 : v32;
+		}
+		else{
+			
+			v32 = cpu->regs[rd];
+			v8 = v32;
+			ok = B ? cpu->memF(cpu, &v8, ea, 1, true, privileged, &fsr) : cpu->memF(cpu, &v32, ea, 4, true, privileged, &fsr);
+			if(!ok){
+				cpuPrvHandleMemErr(cpu, ea, sz, true, false, fsr);
+				return true;
+			}
+		}
+		if(!P || W) cpu->regs[rn] = adr + off;
+		return true;
+	}
+	
+	static _INLINE_ Boolean cpuPrvArmHotBranch(ArmCpu* cpu, UInt32 instr, UInt32 instrPC, Boolean link){
+		
+		UInt32 tmp = instr & 0x00FFFFFFUL;
+		
+		if(tmp & 0x00800000UL) tmp |= 0xFF000000UL;
+		tmp = (tmp << 2) + instrPC + 8;
+		if(link){
+			
+			cpu->regs[14] = instrPC + 4;
+			cpuPrvCallMade(cpu, cpu->regs[14]);
+		}
+		else if(tmp == instrPC && !(cpu->CPSR & ARM_SR_I)) cpuSleep(cpu);	//same idle loop check as the generic path
+		cpu->regs[15] = tmp;
+		return true;
+	}
+	
+	static _INLINE_ Boolean cpuPrvArmHotMul(ArmCpu* cpu, UInt32 instr, Boolean S, Boolean acc, Boolean lng, Boolean sgn){	//native 64-bit math, flags straight from the result
+		
+		UInt8 rd = (instr >> 16) & 0x0F, rn = (instr >> 12) & 0x0F, rs = (instr >> 8) & 0x0F, rm = instr & 0x0F;
+		UInt32 res, hi;
+		UInt64 v64;
+		
+		if(rd == 15 || rs == 15 || rm == 15 || ((acc || lng) ? rn == 15 : rn != 0)) return false;	//unpredictable or invalid: generic path decides
+		
+		if(lng){
+			
+			v64 = sgn ? u64_smul3232(cpu->regs[rm], cpu->regs[rs]) : u64_umul3232(cpu->regs[rm], cpu->regs[rs]);
+			if(acc) v64 = u64_add(v64, u64_from_halves(cpu->regs[rd], cpu->regs[rn]));
+			res = u64_64_to_32(v64);
+			hi = u64_get_hi(v64);
+			cpu->regs[rn] = res;
+			cpu->regs[rd] = hi;
+			res |= hi;		//flags: N from hi, Z from all 64 bits
+		}
+		else{
+			
+			hi = res = cpu->regs[rm] * cpu->regs[rs] + (acc ? cpu->regs[rn] : 0);
+			cpu->regs[rd] = res;
+		}
+		
+		if(S){
+			
+			UInt32 sr = cpu->CPSR &~ (ARM_SR_Z | ARM_SR_N);
+			
+			if(!res) sr |= ARM_SR_Z;
+			if(hi & 0x80000000UL) sr |= ARM_SR_N;
+			cpu->CPSR = sr;
+		}
+		return true;
+	}
+	
+	static Boolean cpuPrvArmHot(ArmCpu* cpu, UInt32 instr, UInt32 instrPC, Boolean privileged){	//false if the generic path has to do it
+		
+		switch(cpuPrvArmHotForm[((instr >> 16) & 0x0FF0) | ((instr >> 4) & 0x0F)]){
+			
+			case ARM_HOT_MOV_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, false, ARM_HOT_ALU_MOV);
+			case ARM_HOT_MOV_REG:	return cpuPrvArmHotAlu(cpu, instr, false, false, ARM_HOT_ALU_MOV);
+			case ARM_HOT_ADD_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, false, ARM_HOT_ALU_ADD);
+			case ARM_HOT_ADD_REG:	return cpuPrvArmHotAlu(cpu, instr, false, false, ARM_HOT_ALU_ADD);
+			case ARM_HOT_ADDS_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, true, ARM_HOT_ALU_ADD);
+			case ARM_HOT_ADDS_REG:	return cpuPrvArmHotAlu(cpu, instr, false, true, ARM_HOT_ALU_ADD);
+			case ARM_HOT_SUB_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, false, ARM_HOT_ALU_SUB);
+			case ARM_HOT_SUB_REG:	return cpuPrvArmHotAlu(cpu, instr, false, false, ARM_HOT_ALU_SUB);
+			case ARM_HOT_SUBS_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, true, ARM_HOT_ALU_SUB);
+			case ARM_HOT_SUBS_REG:	return cpuPrvArmHotAlu(cpu, instr, false, true, ARM_HOT_ALU_SUB);
+			case ARM_HOT_CMP_IMM:	return cpuPrvArmHotAlu(cpu, instr, true, true, ARM_HOT_ALU_CMP);
+			case ARM_HOT_CMP_REG:	return cpuPrvArmHotAlu(cpu, instr, false, true, ARM_HOT_ALU_CMP);
+			
+			case ARM_HOT_LDR:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, false, true, false);
+			case ARM_HOT_LDR_W:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, false, true, true);
+			case ARM_HOT_LDR_POST:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, false, false, false);
+			case ARM_HOT_LDRB:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, true, true, false);
+			case ARM_HOT_LDRB_W:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, true, true, true);
+			case ARM_HOT_LDRB_POST:	return cpuPrvArmHotLdSt(cpu, instr, privileged, true, true, false, false);
+			case ARM_HOT_STR:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, false, true, false);
+			case ARM_HOT_STR_W:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, false, true, true);
+			case ARM_HOT_STR_POST:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, false, false, false);
+			case ARM_HOT_STRB:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, true, true, false);
+			case ARM_HOT_STRB_W:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, true, true, true);
+			case ARM_HOT_STRB_POST:	return cpuPrvArmHotLdSt(cpu, instr, privileged, false, true, false, false);
+			
+			case ARM_HOT_B:		return cpuPrvArmHotBranch(cpu, instr, instrPC, false);
+			case ARM_HOT_BL:	return cpuPrvArmHotBranch(cpu, instr, instrPC, true);
+			
+			case ARM_HOT_MUL:	return cpuPrvArmHotMul(cpu, instr, false, false, false, false);
+			case ARM_HOT_MULS:	return cpuPrvArmHotMul(cpu, instr, true, false, false, false);
+			case ARM_HOT_MLA:	return cpuPrvArmHotMul(cpu, instr, false, true, false, false);
+			case ARM_HOT_MLAS:	return cpuPrvArmHotMul(cpu, instr, true, true, false, false);
+			case ARM_HOT_UMULL:	return cpuPrvArmHotMul(cpu, instr, false, false, true, false);
+			case ARM_HOT_UMULLS:	return cpuPrvArmHotMul(cpu, instr, true, false, true, false);
+			case ARM_HOT_UMLAL:	return cpuPrvArmHotMul(cpu, instr, false, true, true, false);
+			case ARM_HOT_UMLALS:	return cpuPrvArmHotMul(cpu, instr, true, true, true, false);
+			case ARM_HOT_SMULL:	return cpuPrvArmHotMul(cpu, instr, false, false, true, true);
+			case ARM_HOT_SMULLS:	return cpuPrvArmHotMul(cpu, instr, true, false, true, true);
+			case ARM_HOT_SMLAL:	return cpuPrvArmHotMul(cpu, instr, false, true, true, true);
+			case ARM_HOT_SMLALS:	return cpuPrvArmHotMul(cpu, instr, true, true, true, true);
+			
+			default:		return false;
+		}
+	}
+
+#endif
+
 static Err cpuPrvCycleArm(ArmCpu* cpu){
 	
 	Boolean privileged;
@@ -2239,13 +2667,17 @@ static Err cpuPrvCycleArm(ArmCpu* cpu){
 	privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
 	//fetch instruction
 	{
-		if(!icacheFetch(&cpu->ic, pc = cpu->regs[15], 4, privileged, &fsr, &instr)){
+		if(!cpuPrvFetch(cpu, pc = cpu->regs[15], 4, privileged, &fsr, &instr)){
 			cpuPrvHandleMemErr(cpu, cpu->regs[15], 4, false, true, fsr);
 			return errNone;						//exit here so that debugger can see us execute first instr of execption handler
 		}
 		cpu->regs[15] += 4;
 	}
 	
+	#ifdef ARM_HOT_FORMS
+		if((instr >> 28) == 0x0E && cpuPrvArmHot(cpu, instr, pc, privileged)) return errNone;
+	#endif
+	
 	return cpuPrvExecInstr(cpu, instr, pc, false, privileged, false);
 }
 
@@ -2260,7 +2692,7 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 	privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
 	
 	pc = cpu->regs[15];
-	if(!icacheFetch(&cpu->ic, pc, 2, privileged, &fsr, &instrT)){
+	if(!cpuPrvFetch(cpu, pc, 2, privileged, &fsr, &instrT)){
 		cpuPrvHandleMemErr(cpu, pc, 2, false, true, fsr);
 		return errNone;						//exit here so that debugger can see us execute first instr of execption handler
 	}
@@ -2353,8 +2785,10 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 					
 					case 3:			// BX
 						
-						if (instrT & 0x80)	//BLX
+						if (instrT & 0x80){	//BLX
 							cpu->regs[14] = cpu->regs[15] + 1;
+							cpuPrvCallMade(cpu, cpu->regs[14]);
+						}
 	
 						if(instrT == 0x4778){	//special handing for thumb's "BX PC" as aparently docs are wrong on it
 							
@@ -2567,6 +3001,7 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 					instr = cpu->regs[15];
 					cpu->regs[15] = (cpu->regs[14] + 2 + (((UInt32)v16) << 1)) &~ 3UL;
 					cpu->regs[14] = instr | 1UL;
+					cpuPrvCallMade(cpu, instr);
 					cpu->CPSR &=~ ARM_SR_T;
 					goto instr_done;
 				
@@ -2580,6 +3015,7 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 					instr = cpu->regs[15];
 					cpu->regs[15] = cpu->regs[14] + 2 + (((UInt32)v16) << 1);
 					cpu->regs[14] = instr | 1UL;
+					cpuPrvCallMade(cpu, instr);
 					goto instr_done;
 			}
 			
@@ -2603,6 +3039,99 @@ undefined:
 	goto instr_execute;
 }
 
+#ifdef ARM_THREADED
+
+	static void cpuPrvArmClassInit(void){	//mirrors the decode in cpuPrvExecInstr()'s switch
+		
+		UInt16 i;
+		UInt8 op, lo, cls;
+		
+		for(i = 0; i < 4096; i++){
+			
+			op = i >> 4;		//bits 27..20
+			lo = i & 0x0F;		//bits 7..4
+			
+			switch(op >> 5){
+				
+				case 0:
+					if((lo & 0x09) == 0x09) cls = (lo == 0x09) ? ARM_CLS_MUL_SWP : ARM_CLS_LDST_EXTRA;
+					else if((op & 0x19) == 0x10) cls = ARM_CLS_MISC;
+					else cls = ARM_CLS_DP;
+					break;
+				
+				case 1:
+					cls = ((op & 0x19) == 0x10) ? ARM_CLS_MSR_IMM : ARM_CLS_DP;
+					break;
+				
+				case 2:
+					cls = ARM_CLS_LDST;
+					break;
+				
+				case 3:
+					cls = (lo & 1) ? ARM_CLS_MEDIA : ARM_CLS_LDST;
+					break;
+				
+				case 4:
+					cls = ARM_CLS_LDM_STM;
+					break;
+				
+				case 5:
+					cls = ARM_CLS_BRANCH;
+					break;
+				
+				case 6:
+					cls = ARM_CLS_CP_MEM;
+					break;
+				
+				default:
+					cls = (op & 0x10) ? ARM_CLS_SWI : ARM_CLS_CP_REG;
+					break;
+			}
+			cpuPrvArmClass[i] = cls;
+		}
+	}
+
+#endif
+
+#ifdef ARM_HOT_FORMS
+
+	static void cpuPrvArmHotInit(void){
+		
+		static const UInt8 dp[16][2][2] = {	//[opcode][imm][S]
+			[2] = {{ARM_HOT_SUB_REG, ARM_HOT_SUBS_REG}, {ARM_HOT_SUB_IMM, ARM_HOT_SUBS_IMM}},
+			[4] = {{ARM_HOT_ADD_REG, ARM_HOT_ADDS_REG}, {ARM_HOT_ADD_IMM, ARM_HOT_ADDS_IMM}},
+			[10] = {{ARM_HOT_NONE, ARM_HOT_CMP_REG}, {ARM_HOT_NONE, ARM_HOT_CMP_IMM}},
+			[13] = {{ARM_HOT_MOV_REG, ARM_HOT_NONE}, {ARM_HOT_MOV_IMM, ARM_HOT_NONE}},
+		};
+		static const UInt8 mul[16] = {		//by bits 23..20
+			ARM_HOT_MUL, ARM_HOT_MULS, ARM_HOT_MLA, ARM_HOT_MLAS, ARM_HOT_NONE, ARM_HOT_NONE, ARM_HOT_NONE, ARM_HOT_NONE,
+			ARM_HOT_UMULL, ARM_HOT_UMULLS, ARM_HOT_UMLAL, ARM_HOT_UMLALS, ARM_HOT_SMULL, ARM_HOT_SMULLS, ARM_HOT_SMLAL, ARM_HOT_SMLALS,
+		};
+		static const UInt8 ldst[2][2][3] = {	//[L][B][pre, pre with writeback, post]
+			{{ARM_HOT_STR, ARM_HOT_STR_W, ARM_HOT_STR_POST}, {ARM_HOT_STRB, ARM_HOT_STRB_W, ARM_HOT_STRB_POST}},
+			{{ARM_HOT_LDR, ARM_HOT_LDR_W, ARM_HOT_LDR_POST}, {ARM_HOT_LDRB, ARM_HOT_LDRB_W, ARM_HOT_LDRB_POST}},
+		};
+		UInt16 i;
+		UInt8 op, lo, form;
+		
+		for(i = 0; i < 4096; i++){
+			
+			op = i >> 4;		//bits 27..20
+			lo = i & 0x0F;		//bits 7..4
+			form = ARM_HOT_NONE;
+			
+			if((op >> 5) == 1) form = dp[(op >> 1) & 0x0F][1][op & 1];					//data processing imm
+			else if(op < 0x10 && lo == 0x09) form = mul[op];									//multiplies
+			else if((op >> 5) == 0 && !lo) form = dp[(op >> 1) & 0x0F][0][op & 1];				//data processing reg, unshifted if bits 11..8 are clear too
+			else if((op >> 5) == 2 && (op & 0x12) != 0x02) form = ldst[op & 1][(op >> 2) & 1][(op & 0x10) ? ((op >> 1) & 1) : 2];	//not LDRT/STRT
+			else if((op >> 5) == 5) form = (op & 0x10) ? ARM_HOT_BL : ARM_HOT_B;
+			
+			cpuPrvArmHotForm[i] = form;
+		}
+	}
+
+#endif
+
 Err cpuInit(ArmCpu* cpu, UInt32 pc, ArmCpuMemF memF, ArmCpuEmulErr emulErrF, ArmCpuHypercall hypercallF, ArmSetFaultAdrF setFaultAdrF){
 	
 	/*if(!TYPE_CHECK){
@@ -2614,6 +3143,14 @@ Err cpuInit(ArmCpu* cpu, UInt32 pc, ArmCpuMemF memF, ArmCpuEmulErr emulErrF, Arm
 	
 	cpu->CPSR = ARM_SR_I | ARM_SR_F | ARM_SR_MODE_SVC;	//start w/o interrupts in supervisor mode
 	cpuPrvSetPC(cpu, pc);
+	cpuMapChanged(cpu);
+	
+	#ifdef ARM_THREADED
+		cpuPrvArmClassInit();
+	#endif
+	#ifdef ARM_HOT_FORMS
+		cpuPrvArmHotInit();
+	#endif
 
 	cpu->memF = memF;
 	cpu->emulErrF = emulErrF;
@@ -2630,7 +3167,7 @@ Err cpuDeinit(_UNUSED_ ArmCpu* cpu){
 	return errNone;
 }
 
-void cpuCycle(ArmCpu* cpu){
+static void cpuPrvInterrupts(ArmCpu* cpu){	//something is waiting, take it if it is not masked
 
 	UInt32 vector, newCPSR;
 
@@ -2652,12 +3189,15 @@ void cpuCycle(ArmCpu* cpu){
 	}
 #endif
 	else{
-		goto normal;
+		return;
 	}
 
 	cpuPrvException(cpu, vector, cpu->regs[15] + 4, newCPSR);
+}
 
-normal:
+static _INLINE_ void cpuPrvStep(ArmCpu* cpu){
+
+	if(cpu->attention & ARM_ATTN_INTS) cpuPrvInterrupts(cpu);
 
 	if(cpu->CPSR & ARM_SR_T){
 		cpuPrvCycleThumb(cpu);
@@ -2668,8 +3208,38 @@ normal:
 	}
 }
 
+void cpuCycle(ArmCpu* cpu){
+
+	cpuPrvStep(cpu);
+}
+
+void cpuRun(ArmCpu* cpu, UInt32* cycles, UInt32 n){
+
+	while(1){
+		
+		cpuPrvStep(cpu);
+		if(!--n || (cpu->attention & ARM_ATTN_STOP)) break;
+		(*cycles)++;
+	}
+	cpu->attention &=~ ARM_ATTN_STOP;
+}
+
+void cpuStop(ArmCpu* cpu){
+
+	cpu->attention |= ARM_ATTN_STOP;
+}
+
+static void cpuPrvRecalcAttention(ArmCpu* cpu){
+
+	cpu->attention &=~ (ARM_ATTN_IRQ | ARM_ATTN_FIQ);
+	if(cpu->waitingIrqs) cpu->attention |= ARM_ATTN_IRQ;
+	if(cpu->waitingFiqs) cpu->attention |= ARM_ATTN_FIQ;
+}
+
 void cpuIrq(ArmCpu* cpu, Boolean fiq, Boolean raise){	//unraise when acknowledged
 
+	if(raise) cpu->sleeping = false;
+	
 	if(fiq){
 		if(raise){
 			cpu->waitingFiqs++;
@@ -2692,11 +3262,21 @@ void cpuIrq(ArmCpu* cpu, Boolean fiq, Boolean raise){	//unraise when acknowledge
 			cpu->emulErrF(cpu,"IRQ error!");
 		}
 	}
+	cpuPrvRecalcAttention(cpu);
+}
+
+void cpuSleep(ArmCpu* cpu){
+
+	if(cpu->waitingIrqs || cpu->waitingFiqs) return;
+	
+	cpu->sleeping = true;
+	cpu->attention |= ARM_ATTN_STOP;
 }
 
 void cpuIcacheInval(ArmCpu* cpu){
 
 	icacheInval(&cpu->ic);
+	cpuMapChanged(cpu);
 }
 
 void cpuIcacheInvalAddr(ArmCpu* cpu, UInt32 addr){
@@ -2704,6 +3284,18 @@ void cpuIcacheInvalAddr(ArmCpu* cpu, UInt32 addr){
 	icacheInvalAddr(&cpu->ic, addr);
 }
 
+void cpuCodeWritten(ArmCpu* cpu){	//icache lines are tagged by VA, we cannot pick out one physical page's. the whole icache is 8 lines
+
+	icacheInval(&cpu->ic);
+}
+
+void cpuMapChanged(_UNUSED_ ArmCpu* cpu){
+
+#ifdef ARM_BRANCH_CACHE
+	cpuPrvFetchFlush(cpu);
+#endif
+}
+
 
 void cpuCoprocessorRegister(ArmCpu* cpu, UInt8 cpNum, ArmCoprocessor* coproc){
 
@@ -2719,11 +3311,57 @@ void cpuCoprocessorUnregister(ArmCpu* cpu, UInt8 cpNum){
 	cpu->coproc[cpNum] = cp;	
 }
 
+Boolean cpuCoprocMemAccess(ArmCpu* cpu, UInt32* buf, UInt32 vaddr, UInt8 words, Boolean write){
+
+	Boolean privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
+	UInt8 fsr = 0, i;
+	
+#ifndef EMBEDDED
+	UInt32* p;
+	
+	if(cpu->ptrF && !(vaddr & 3) && (p = cpu->ptrF(cpu, vaddr, words * 4, write, privileged))){	//plain RAM
+		
+		for(i = 0; i < words; i++){
+			if(write) p[i] = buf[i];
+			else buf[i] = p[i];
+		}
+		return true;
+	}
+	if((words > 2 || (words == 2 && !(vaddr & 7))) && cpu->memF(cpu, buf, vaddr, words * 4, write, privileged, &fsr)) return true;	//one burst, else the word loop finds the fault
+#endif
+	
+	for(i = 0; i < words; i++, vaddr += 4){
+		
+		if(!cpu->memF(cpu, buf + i, vaddr, 4, write, privileged, &fsr)){
+			
+			cpuPrvHandleMemErr(cpu, vaddr, 4, write, false, fsr);
+			cpu->coprocAbort = true;
+			return false;
+		}
+	}
+	return true;
+}
+
 void cpuSetVectorAddr(ArmCpu* cpu, UInt32 adr){
 	
 	cpu->vectorBase = adr;	
 }
 
+#ifndef EMBEDDED
+
+	void cpuSetPtrF(ArmCpu* cpu, ArmCpuPtrF ptrF){
+		
+		cpu->ptrF = ptrF;
+	}
+	
+	void cpuSetFetchF(ArmCpu* cpu, ArmCpuMemF fetchF){
+		
+		cpu->ic.memF = fetchF;
+		icacheInval(&cpu->ic);
+	}
+
+#endif
+
 UInt16 cpuGetCPAR(ArmCpu* cpu){
 	
 	return cpu->CPAR;	
@@ -2739,6 +3377,8 @@ void cpuSetCPAR(ArmCpu* cpu, UInt16 cpar){
 	void cpuSignalImpreciseAbt(ArmCpu* cpu, Boolean raise){
 		
 		cpu->impreciseAbtWaiting = raise;
+		if(raise) cpu->attention |= ARM_ATTN_ABT;
+		else cpu->attention &=~ ARM_ATTN_ABT;
 	}
 
 
@@ -4,6 +4,13 @@
 
 //#define ARM_V6		//define to allow v6 instructions
 //#define THUMB_2			//define to allow Thumb2
+#if !defined(EMBEDDED) && defined(__GNUC__)
+	#define ARM_THREADED		//dispatch ARM instrs via a table of label addresses (GCC computed goto), not the switch
+#endif
+#ifndef EMBEDDED
+	#define ARM_HOT_FORMS		//AL ARM instrs of the commonest forms skip the generic decoder (costs a 4K table)
+	#define ARM_BRANCH_CACHE	//fetch straight from host RAM, remember where return addresses and branch targets live there
+#endif
 
 #include "types.h"
 #include "rt.h"
@@ -48,9 +55,19 @@ struct ArmCpu;
 #define ARM_VECTOR_OFFT_IRQ	0x00000018UL
 #define ARM_VECTOR_OFFT_FIQ	0x0000001CUL
 
+#define ARM_ATTN_IRQ		0x01	//bits of ArmCpu.attention: an IRQ is waiting (maybe masked)
+#define ARM_ATTN_FIQ		0x02	//an FIQ is waiting (maybe masked)
+#define ARM_ATTN_ABT		0x04	//an imprecise abort is waiting (maybe masked)
+#define ARM_ATTN_STOP		0x08	//cpuRun() should return after this instruction
+#define ARM_ATTN_INTS		(ARM_ATTN_IRQ | ARM_ATTN_FIQ | ARM_ATTN_ABT)
+
 #define HYPERCALL_ARM		0xF7BBBBBBUL
 #define HYPERCALL_THUMB		0xBBBBUL
 
+#define ARM_CP_ADR_P		0x04	//memAccess adrMode: P bit, offset applied before the access
+#define ARM_CP_ADR_U		0x02	//U bit, offset added rather than subtracted
+#define ARM_CP_ADR_W		0x01	//W bit, base written back
+
 //the following are for cpuGetRegExternal() and are generally used for debugging purposes
 #define ARM_REG_NUM_CPSR	16
 #define ARM_REG_NUM_SPSR	17
@@ -59,10 +76,11 @@ struct ArmCpu;
 
 typedef Boolean	(*ArmCoprocRegXferF)	(struct ArmCpu* cpu, void* userData, Boolean two/* MCR2/MRC2 ? */, Boolean MRC, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2);
 typedef Boolean	(*ArmCoprocDatProcF)	(struct ArmCpu* cpu, void* userData, Boolean two/* CDP2 ? */, UInt8 op1, UInt8 CRd, UInt8 CRn, UInt8 CRm, UInt8 op2);
-typedef Boolean	(*ArmCoprocMemAccsF)	(struct ArmCpu* cpu, void* userData, Boolean two /* LDC2/STC2 ? */, Boolean N, Boolean store, UInt8 CRd, UInt32 addr, UInt8* option /* NULL if none */);
+typedef Boolean	(*ArmCoprocMemAccsF)	(struct ArmCpu* cpu, void* userData, Boolean two /* LDC2/STC2 ? */, Boolean N, Boolean store, UInt8 CRd, UInt32 addr, UInt8* option /* NULL if none */, UInt8 words /* base reg moves by this many, 0 if not written back */, UInt8 adrMode /* ARM_CP_ADR_* */);	//transfers go through cpuCoprocMemAccess()
 typedef Boolean (*ArmCoprocTwoRegF)	(struct ArmCpu* cpu, void* userData, Boolean MRRC, UInt8 op, UInt8 Rd, UInt8 Rn, UInt8 CRm);
 
 typedef Boolean	(*ArmCpuMemF)		(struct ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged, UInt8* fsr);	//read/write
+typedef UInt32*	(*ArmCpuPtrF)		(struct ArmCpu* cpu, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged);	//host pointer to plain RAM behind these words, NULL to go through memF instead (which also reports faults)
 typedef Boolean	(*ArmCpuHypercall)	(struct ArmCpu* cpu);		//return true if handled
 typedef void	(*ArmCpuEmulErr)	(struct ArmCpu* cpu, const char* err_str);
 
@@ -77,7 +95,7 @@ typedef void	(*ArmSetFaultAdrF)	(struct ArmCpu* cpu, UInt32 adr, UInt8 faultStat
 				
 				0    - DSP (pxa only)
 				0, 1 - WMMX (pxa only)
-				11   - VFP (arm standard)
+				10, 11 - VFP (arm standard, host builds only)
 				15   - system control (arm standard)
 */
 
@@ -98,6 +116,23 @@ typedef struct{
 	UInt32 SPSR;			//usr mode doesn't have an SPSR
 }ArmBankedRegs;
 
+#ifdef ARM_BRANCH_CACHE
+
+	#define ARM_FETCH_PAGE		1024UL	//smallest page there is, so one translation always covers it
+	#define ARM_FETCH_PRIV		1UL	//ArmFetchPage.va bit: translated for privileged access
+	#define ARM_FETCH_NONE		2UL	//ArmFetchPage.va of an empty entry
+	#define ARM_RAS_SZ		8	//powers of two
+	#define ARM_BTC_SZ		64
+
+	typedef struct{
+	
+		UInt32 va;			//page (return address in the RAS) | ARM_FETCH_PRIV if privileged
+		const UInt32* ptr;		//host copy of the page, NULL if it is not plain RAM (icache and memF then)
+		
+	}ArmFetchPage;
+	
+#endif
+
 
 
 
@@ -121,6 +156,9 @@ typedef struct ArmCpu{
 	UInt16		waitingIrqs;
 	UInt16		waitingFiqs;
 	UInt16		CPAR;
+	Boolean		sleeping;		//waiting for an interrupt, SoC should not call cpuCycle()
+	Boolean		coprocAbort;		//cpuCoprocMemAccess() took a data abort, the LDC/STC it was for is over
+	UInt8		attention;		//ARM_ATTN_*, zero when nothing but the next instruction needs doing
 
 	ArmCoprocessor	coproc[16];		//coprocessors
 
@@ -134,12 +172,27 @@ typedef struct ArmCpu{
 #endif
 
 	ArmCpuMemF	memF;
+#ifndef EMBEDDED
+	ArmCpuPtrF	ptrF;			//optional, for LDM/STM
+#endif
 	ArmCpuEmulErr	emulErrF;
 	ArmCpuHypercall	hypercallF;
 	ArmSetFaultAdrF	setFaultAdrF;
 	
 	icache		ic;
 
+#ifdef ARM_BRANCH_CACHE
+
+	ArmFetchPage	fetch;			//page instrs are coming from now
+	ArmFetchPage	ras[ARM_RAS_SZ];	//return address stack, circular: calls made from a page and where that page is
+	UInt8		rasTop, rasNum;
+	ArmFetchPage	btc[ARM_BTC_SZ];	//branch target cache: pages fetch went to, by page number
+	
+	UInt32		rasHits;		//fetch changed pages: to a return address on the RAS
+	UInt32		btcHits;		//to a page the BTC had
+	UInt32		btcMisses;		//to a page that had to be translated
+#endif
+
 	void*		userData;		//shared by all callbacks
 }ArmCpu;
 
@@ -147,7 +200,10 @@ typedef struct ArmCpu{
 Err cpuInit(ArmCpu* cpu, UInt32 pc, ArmCpuMemF memF, ArmCpuEmulErr emulErrF, ArmCpuHypercall hypercallF, ArmSetFaultAdrF setFaultAdrF);
 Err cpuDeinit(ArmCpu* cp);
 void cpuCycle(ArmCpu* cpu);
+void cpuRun(ArmCpu* cpu, UInt32* cycles, UInt32 n);	//up to n instructions, *cycles goes up by one between them. returns early if asked to (cpuStop(), cpuSleep())
+void cpuStop(ArmCpu* cpu);				//make cpuRun() return after the current instruction
 void cpuIrq(ArmCpu* cpu, Boolean fiq, Boolean raise);	//unraise when acknowledged
+void cpuSleep(ArmCpu* cpu);				//wait for interrupt, raising one (masked or not) wakes us
 
 #ifdef ARM_V6
 
@@ -160,14 +216,21 @@ void cpuSetReg(ArmCpu* cpu, UInt8 reg, UInt32 val);
 
 void cpuCoprocessorRegister(ArmCpu* cpu, UInt8 cpNum, ArmCoprocessor* coproc);
 void cpuCoprocessorUnregister(ArmCpu* cpu, UInt8 cpNum);
+Boolean cpuCoprocMemAccess(ArmCpu* cpu, UInt32* buf, UInt32 vaddr, UInt8 words, Boolean write);	//for memAccess callbacks, with the current mode's permissions. false if it faulted: the data abort is taken, return at once
 
 void cpuSetVectorAddr(ArmCpu* cpu, UInt32 adr);
+#ifndef EMBEDDED
+	void cpuSetPtrF(ArmCpu* cpu, ArmCpuPtrF ptrF);
+	void cpuSetFetchF(ArmCpu* cpu, ArmCpuMemF fetchF);	//memF for icache fills, so instruction fetches can be told apart. defaults to memF
+#endif
 
 UInt16 cpuGetCPAR(ArmCpu* cpu);
 void cpuSetCPAR(ArmCpu* cpu, UInt16 cpar);
 
 void cpuIcacheInval(ArmCpu* cpu);
 void cpuIcacheInvalAddr(ArmCpu* cpu, UInt32 addr);
+void cpuMapChanged(ArmCpu* cpu);			//translations or permissions may have changed (TLB flush, TTB, domains, MMU on/off)
+void cpuCodeWritten(ArmCpu* cpu);			//memory instrs were fetched from was written, cached copies are stale
 
 
 #endif
@@ -2,112 +2,105 @@
 #include "RAM.h"
 
 
-	
+#ifndef EMBEDDED
+
+	static void ramPrvMarkDirty(ArmRam* ram, UInt32 ofst, UInt32 size){	//bursts are under a page so they touch two at most
+		
+		ram->dirty[ofst >> (RAM_DIRTY_PAGE_SHIFT + 5)] |= 1UL << ((ofst >> RAM_DIRTY_PAGE_SHIFT) & 31);
+		ofst += size - 1;
+		ram->dirty[ofst >> (RAM_DIRTY_PAGE_SHIFT + 5)] |= 1UL << ((ofst >> RAM_DIRTY_PAGE_SHIFT) & 31);
+	}
+
+#endif
+
 static Boolean ramAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* bufP){
 	
 	ArmRam* ram = userData;
 	UInt8* addr = (UInt8*)ram->buf;
+	UInt32 *src, *dst;
 	
 	pa -= ram->adr;
-	if(pa >= ram->sz) return false;
+	if(pa >= ram->sz || ram->sz - pa < size) return false;
 	
 	addr += pa;
 	
-	if(write){
+#ifndef EMBEDDED
+	if(write && ram->dirty) ramPrvMarkDirty(ram, pa, size);
+#endif
+	
+	switch(size){
 		
-		switch(size){
+		case 1:
 			
-			case 1:
+			if(write) *((UInt8*)addr) = *(UInt8*)bufP;	//our memory system is little-endian
+			else *(UInt8*)bufP = *((UInt8*)addr);
+			break;
 		
-				*((UInt8*)addr) = *(UInt8*)bufP;	//our memory system is little-endian
-				break;
-			
-			case 2:
-			
-				*((UInt16*)addr) = *(UInt16*)bufP;	//our memory system is little-endian
-				break;
+		case 2:
 			
-			case 4:
-			
-				*((UInt32*)addr) = *(UInt32*)bufP;
-				break;
-			
-			case 8:
-			
-				*((UInt32*)(addr + 0)) = ((UInt32*)bufP)[0];
-				*((UInt32*)(addr + 4)) = ((UInt32*)bufP)[1];
-				break;
-			
-			default:
-			
-				return false;
-		}
-	}
-	else{
+			if(write) *((UInt16*)addr) = *(UInt16*)bufP;	//our memory system is little-endian
+			else *(UInt16*)bufP = *((UInt16*)addr);
+			break;
 		
-		switch(size){
-			
-			case 1:
-				
-				*(UInt8*)bufP = *((UInt8*)addr);
-				break;
-			
-			case 2:
+		case 4:
 			
-				*(UInt16*)bufP = *((UInt16*)addr);
-				break;
-			
-			case 4:
-			
-				*(UInt32*)bufP = *((UInt32*)addr);
-				break;
-			
-			case 64:
-				((UInt32*)bufP)[ 8] = *((UInt32*)(addr + 32));
-				((UInt32*)bufP)[ 9] = *((UInt32*)(addr + 36));
-				((UInt32*)bufP)[10] = *((UInt32*)(addr + 40));
-				((UInt32*)bufP)[11] = *((UInt32*)(addr + 44));
-				((UInt32*)bufP)[12] = *((UInt32*)(addr + 48));
-				((UInt32*)bufP)[13] = *((UInt32*)(addr + 52));
-				((UInt32*)bufP)[14] = *((UInt32*)(addr + 56));
-				((UInt32*)bufP)[15] = *((UInt32*)(addr + 60));
-				//fallthrough
-			case 32:
-			
-				((UInt32*)bufP)[4] = *((UInt32*)(addr + 16));
-				((UInt32*)bufP)[5] = *((UInt32*)(addr + 20));
-				((UInt32*)bufP)[6] = *((UInt32*)(addr + 24));
-				((UInt32*)bufP)[7] = *((UInt32*)(addr + 28));
-				//fallthrough
-			case 16:
-				
-				((UInt32*)bufP)[2] = *((UInt32*)(addr +  8));
-				((UInt32*)bufP)[3] = *((UInt32*)(addr + 12));
-				//fallthrough
-			case 8:
-				((UInt32*)bufP)[0] = *((UInt32*)(addr +  0));
-				((UInt32*)bufP)[1] = *((UInt32*)(addr +  4));
-				break;
+			if(write) *((UInt32*)addr) = *(UInt32*)bufP;
+			else *(UInt32*)bufP = *((UInt32*)addr);
+			break;
+		
+		default:	//bursts: icache lines, LDM/STM, LDRD/STRD
 			
-			default:
+			if(size & 3) return false;
 			
-				return false;
-		}
+			src = write ? bufP : (UInt32*)addr;
+			dst = write ? (UInt32*)addr : bufP;
+			size >>= 2;
+			while(size--) *dst++ = *src++;
+			break;
 	}
 	
 	return true;
 }
 
+#ifndef EMBEDDED
+
+	static void* ramPtrF(void* userData, UInt32 pa, UInt32 size, Boolean write){
+		
+		ArmRam* ram = userData;
+		
+		pa -= ram->adr;
+		if(pa >= ram->sz || ram->sz - pa < size) return NULL;
+		if(write && ram->dirty) ramPrvMarkDirty(ram, pa, size);
+		
+		return (UInt8*)ram->buf + pa;
+	}
+
+#endif
+
 Boolean ramInit(ArmRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, UInt32* buf){
 
 	ram->adr = adr;
 	ram->sz = sz;
 	ram->buf = buf;
 	
-	return memRegionAdd(mem, adr, sz, &ramAccessF, ram);	
+#ifdef EMBEDDED
+	return memRegionAddBurst(mem, adr, sz, &ramAccessF, ram);
+#else
+	ram->dirty = NULL;
+	return memRegionAddDirect(mem, adr, sz, &ramAccessF, &ramPtrF, ram);
+#endif
 }
 
 Boolean ramDeinit(ArmRam* ram, ArmMem* mem){
 	
 	return memRegionDel(mem, ram->adr, ram->sz);
 }
+
+#ifndef EMBEDDED
+
+	void ramTrackDirty(ArmRam* ram, UInt32* bitmap){
+		
+		ram->dirty = bitmap;
+	}
+
+#endif
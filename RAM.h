@@ -4,17 +4,25 @@
 
 #include "types.h"
 
+#define RAM_DIRTY_PAGE_SHIFT	12	//write tracking granularity: 4K
+
 typedef struct{
 
 	UInt32 adr;
 	UInt32 sz;
 	UInt32* buf;
+#ifndef EMBEDDED
+	UInt32* dirty;		//a bit per page written to since the owner last cleared it, NULL if nobody is looking
+#endif
 
 }ArmRam;
 
 
 Boolean ramInit(ArmRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, UInt32* buf);
 Boolean ramDeinit(ArmRam* ram, ArmMem* mem);
+#ifndef EMBEDDED
+	void ramTrackDirty(ArmRam* ram, UInt32* bitmap);	//bitmap needs sz >> RAM_DIRTY_PAGE_SHIFT bits, NULL stops tracking
+#endif
 
 
 
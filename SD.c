@@ -13,7 +13,9 @@
 #define	ACMD41	(0xC0+41)	/* SEND_OP_COND (SDC) */
 #define CMD8	(0x40+8)	/* SEND_IF_COND */
 #define CMD16	(0x40+16)	/* SET_BLOCKLEN */
+#define CMD12	(0x40+12)	/* STOP_TRANSMISSION */
 #define CMD17	(0x40+17)	/* READ_SINGLE_BLOCK */
+#define CMD18	(0x40+18)	/* READ_MULTIPLE_BLOCK */
 #define CMD24	(0x40+24)	/* WRITE_BLOCK */
 #define CMD55	(0x40+55)	/* APP_CMD */
 #define CMD58	(0x40+58)	/* READ_OCR */
@@ -101,9 +103,9 @@ static inline void sdPrvSendCmd(UInt8 cmd, UInt32 param, Boolean crc){
 	send[2] = param >> 16;
 	send[3] = param >> 8;
 	send[4] = param;
-	send[5] = crc ? (sdCrc7(send, 5, 0) << 1) | 1 : 0;
+	send[5] = crc ? (sdCrc7(send, 5, 0) << 1) | 1 : 0x01;	//the CRC byte is always sent, only checked if crc
 	
-	for(cmd = 0; cmd < crc ? 6 : 5; cmd++) sdSpiByte(send[cmd]);
+	for(cmd = 0; cmd < 6; cmd++) sdSpiByte(send[cmd]);
 }
 
 static UInt8 sdPrvSimpleCommand(UInt8 cmd, UInt32 param, Boolean crc){  //do a command, return R1 reply
@@ -122,22 +124,25 @@ static UInt8 sdPrvSimpleCommand(UInt8 cmd, UInt32 param, Boolean crc){  //do a c
 	return ret;
 }
 
-static UInt8 sdPrvReadData(UInt8* data, UInt16 sz){
+static UInt8 sdPrvReadData(UInt8* data, UInt16 ofs, UInt16 sz, UInt16 blkSz){	//sz bytes at ofs of a blkSz-byte data block. the rest and the CRC are clocked out so the card is done with it
 	
 	UInt8 ret;
 	UInt8 tries = 200;
+	UInt16 i;
 	
 	do{
 		ret = sdSpiByte(0xFF);
 		if((ret & 0xF0) == 0x00) return ret;    //fail
 		if(ret == 0xFE) break;
-	}while(tries--);
+	}while(--tries);
 	
 	if(!tries) return 0xFF;
 	
-	*data = ret;
-	
-	while(sz--) *data++ = sdSpiByte(0xFF);
+	for(i = 0; i < blkSz + 2; i++){
+		
+		ret = sdSpiByte(0xFF);
+		if(i >= ofs && i - ofs < sz) *data++ = ret;
+	}
 	
 	return 0;
 }
@@ -216,6 +221,7 @@ Boolean sdInit(SD* sd){
 
 	sd->inited = false;
 	sd->SD = false;
+	sd->stream = SD_STREAM_NONE;
 
 	sdClockSpeed(false);
 
@@ -250,7 +256,7 @@ Boolean sdInit(SD* sd){
 	DESELECT();
 	sdSpiByte(0xFF);
 
-	if(sdPrvReadData(respBuf, 16)) return false;
+	if(sdPrvReadData(respBuf, 0, 16, 16)) return false;
 
 	sd->numSec = sdPrvGetCardNumBlocks(!sd->SD, respBuf);
 	sd->inited = !ty;
@@ -260,20 +266,23 @@ Boolean sdInit(SD* sd){
 	return sd->inited;
 }
 
-Boolean sdSecRead(SD* sd, UInt32 sec, void* buf, UInt16 sz){   //CMD17
+static Boolean sdPrvSecRead(SD* sd, UInt32 sec, UInt16 ofs, void* buf, UInt16 sz){   //CMD17
 
 	UInt8 retry = 0;
+	Boolean ret = false;
 
 	//PIND = (UInt8)(1 << 2);   //LED_r
 
 	if(!sd->inited) return false;
+	
+	sdStreamStop(sd);
 
 	do{
 
-		if(sdPrvSimpleCommand(17, sd->HC ? sec : sec << 9, false) & FLAG_TIMEOUT) return false;
+		if(sdPrvSimpleCommand(17, sd->HC ? sec : sec << 9, false) & FLAG_TIMEOUT) break;
 
-		if(!sdPrvReadData(buf, sz)){ // Read sz bytes to buf
-			return true;
+		if(!sdPrvReadData(buf, ofs, sz, SD_BLOCK_SIZE)){ // Read sz bytes at ofs to buf
+			ret = true;
 			break;
 		} 
 
@@ -283,32 +292,48 @@ Boolean sdSecRead(SD* sd, UInt32 sec, void* buf, UInt16 sz){   //CMD17
 
 	DESELECT();
 	sdSpiByte(0xFF);
+	
+	return ret;
+}
+
+Boolean sdSecRead(SD* sd, UInt32 sec, void* buf, UInt16 sz){
+	
+	return sdPrvSecRead(sd, sec, 0, buf, sz);
 }
 
 
+static UInt8 sdPrvWaitResp(){	//data response token of a written block, then busy
+	
+	UInt8 v;
+	
+	while((v = sdSpiByte(0xFF)) == 0xFF);   //wait while card isnt answering
+	while(sdSpiByte(0xFF) != 0xFF); //wait while card is busy
+	
+	return v;
+}
+
 Boolean sdSecWrite(SD* sd, UInt32 sec, UInt8* buf, UInt16 sz){  //CMD24
 
-	UInt8 retry = 0, v;
+	UInt8 retry = 0;
 	
 	//writechar('W');
 
 	//PIND = (UInt8)(1 << 3);   //LED_w
 
 	if(!sd->inited) return false;
+	
+	sdStreamStop(sd);
 
 	do{
 		
 		if(sdPrvSimpleCommand(24, sd->HC ? sec : sec << 9, false) & FLAG_TIMEOUT) return false;
 	
 		sdSpiByte(0xFF);    //as per SD-spi spec, we give it 8 clocks to consider the ramifications of the command we just sent
-		sdSpiByte(0xFF);    //start of data block
+		sdSpiByte(0xFE);    //start of data block
 
-		for(UInt16 v16 = 0; v16 < sz; v16++) sdSpiByte(*buf++);    //data
+		for(UInt16 v16 = 0; v16 < SD_BLOCK_SIZE; v16++) sdSpiByte(v16 < sz ? buf[v16] : 0xFF);    //data, short buffers get padded to a full block
 		
-		while((v = sdSpiByte(0xFF)) == 0xFF);   //wait while card isnt answering
-		while(sdSpiByte(0xFF) != 0xFF); //wait while card is busy
-	
-		if((v & 0x1F) == 5){
+		if((sdPrvWaitResp() & 0x1F) == 5){
 			return true;
 		} 
 	
@@ -317,34 +342,185 @@ Boolean sdSecWrite(SD* sd, UInt32 sec, UInt8* buf, UInt16 sz){  //CMD24
 	//PIND = (UInt8)(1 << 3);   //LED_w
 
 	DESELECT();
-	rcv_spi();
+	sdSpiByte(0xFF);
+	
+	return false;
+}
+
+Boolean sdReadStart(SD* sd, UInt32 sec){	//CMD18
+	
+	if(!sd->inited) return false;
+	
+	sdStreamStop(sd);
+	
+	if(sdPrvSimpleCommand(18, sd->HC ? sec : sec << 9, false)) return false;
+	
+	sd->stream = SD_STREAM_READ;
+	sd->streamSec = sec;
+	
+	return true;
+}
+
+Boolean sdReadNext(SD* sd, void* buf){
+	
+	if(sd->stream != SD_STREAM_READ) return false;
+	
+	SELECT();	//card keeps the transfer going while deselected between blocks
+	if(sdPrvReadData(buf, 0, SD_BLOCK_SIZE, SD_BLOCK_SIZE)){
+		
+		sdStreamStop(sd);
+		return false;
+	}
+	sd->streamSec++;
+	
+	return true;
+}
+
+void sdStreamStop(SD* sd){
+	
+	UInt8 i = 0;
+	
+	if(sd->stream == SD_STREAM_READ){
+		
+		sdPrvSendCmd(12, 0, false);
+		sdSpiByte(0xFF);	//stuff byte
+		while(i++ < 128 && sdSpiByte(0xFF) == 0xFF);	//R1
+		while(sdSpiByte(0xFF) != 0xFF);	//busy
+	}
+	else return;
+	
+	sd->stream = SD_STREAM_NONE;
+	DESELECT();
+	sdSpiByte(0xFF);
+}
+
+Boolean sdStreamRead(SD* sd, UInt32 sec, void* buf){
+	
+	if((sd->stream != SD_STREAM_READ || sd->streamSec != sec) && !sdReadStart(sd, sec)) return false;
+	
+	return sdReadNext(sd, buf);
 }
 
-/* @raspiduino's code */
+/*
+	SD-backed guest RAM, with a small write-back cache of lines in SRAM.
 
-void ramRead(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz){
+	Every line gets a sector of its own (line data first, rest padding), so
+	a miss fills with a partial read of the sector head and an eviction is
+	a plain full-block write: no read-modify-write of 512-byte sectors and
+	no sector buffer in SRAM. Writes covering a whole line skip the fill.
+*/
 
-	UInt8* b;
-	UInt8 sec_addr = addr%SD_BLOCK_SIZE;
+static UInt8 gLineData[SD_RAM_LINES][SD_RAM_LINE_SZ];
+static UInt32 gLineTag[SD_RAM_LINES];	//line number + 1, 0 = empty
+static UInt8 gLineDirty;		//bit per line
 
-	sdSecRead(sd, sd->numSec + (addr - 1024*16)/SD_BLOCK_SIZE, b, sz + sec_addr); // Read the sector contain the addr
+static UInt32 sdPrvRamSec(SD* sd, UInt32 line){
+	
+	return sd->numSec - SD_RAM_SIZE / SD_RAM_LINE_SZ + line;
+}
+
+static Boolean sdPrvRamEvict(SD* sd, UInt8 idx){
+	
+	if(!(gLineDirty & (1 << idx))) return true;
+	if(!sdSecWrite(sd, sdPrvRamSec(sd, gLineTag[idx] - 1), gLineData[idx], SD_RAM_LINE_SZ)) return false;
+	gLineDirty &=~ (1 << idx);
+	
+	return true;
+}
 
-	for(UInt8 i = 0 ; i < sz; i++){
-		buf[i] = b[i + sec_addr];
+static UInt8* sdPrvRamLine(SD* sd, UInt32 addr, Boolean fill){	//find or load the line containing addr, NULL on a card error
+	
+	UInt32 line = addr / SD_RAM_LINE_SZ;
+	UInt8 idx = line % SD_RAM_LINES;
+	
+	if(gLineTag[idx] != line + 1){
+		
+		if(!sdPrvRamEvict(sd, idx)) return NULL;
+		if(fill && !sdSecRead(sd, sdPrvRamSec(sd, line), gLineData[idx], SD_RAM_LINE_SZ)){
+			
+			gLineTag[idx] = 0;	//holds neither the old line nor the new one
+			return NULL;
+		}
+		gLineTag[idx] = line + 1;
 	}
+	
+	return gLineData[idx];
 }
 
-void ramWrite(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz){
+Boolean ramRead(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz){
+
+	UInt8 ofs, n, *line;
+	
+	while(sz){
+		
+		ofs = addr % SD_RAM_LINE_SZ;
+		n = SD_RAM_LINE_SZ - ofs;
+		if(n > sz) n = sz;
+		
+		line = sdPrvRamLine(sd, addr, true);
+		if(!line) return false;
+		line += ofs;
+		addr += n;
+		sz -= n;
+		while(n--) *buf++ = *line++;
+	}
+	
+	return true;
+}
 
-	UInt8* b;
-	UInt8 sec_addr = addr%SD_BLOCK_SIZE;
-	UInt32 sec = sd->numSec + (addr - 1024*16)/SD_BLOCK_SIZE; // Read the data from the begining of that sector to the addr
+Boolean ramWrite(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz){
 
-	sdSecRead(sd, sec, b, addr%SD_BLOCK_SIZE);
+	UInt8 ofs, n, *line;
+	
+	while(sz){
+		
+		ofs = addr % SD_RAM_LINE_SZ;
+		n = SD_RAM_LINE_SZ - ofs;
+		if(n > sz) n = sz;
+		
+		line = sdPrvRamLine(sd, addr, n != SD_RAM_LINE_SZ);
+		if(!line) return false;
+		gLineDirty |= 1 << ((addr / SD_RAM_LINE_SZ) % SD_RAM_LINES);
+		line += ofs;
+		addr += n;
+		sz -= n;
+		while(n--) *line++ = *buf++;
+	}
+	
+	return true;
+}
 
-	for(UInt8 i = 0; i < sz; i++){
-		b[i+sec_addr] = buf[i];
+Boolean ramLoad(SD* sd, UInt32 addr, UInt32 sec, UInt32 num){
+	
+	UInt32 dst;
+	UInt16 ofs;
+	UInt8 i, n;
+	
+	if(!ramFlush(sd)) return false;
+	for(i = 0; i < SD_RAM_LINES; i++) gLineTag[i] = 0;
+	
+	//the emptied cache is the bounce buffer: it takes up to SD_RAM_LINES lines' worth of a card sector, then each goes to its own RAM sector
+	for(dst = sdPrvRamSec(sd, addr / SD_RAM_LINE_SZ); num--; sec++){
+		
+		for(ofs = 0; ofs < SD_BLOCK_SIZE; ofs += n * SD_RAM_LINE_SZ){
+			
+			n = (SD_BLOCK_SIZE - ofs) / SD_RAM_LINE_SZ;
+			if(n > SD_RAM_LINES) n = SD_RAM_LINES;
+			
+			if(!sdPrvSecRead(sd, sec, ofs, gLineData, n * SD_RAM_LINE_SZ)) return false;
+			for(i = 0; i < n; i++) if(!sdSecWrite(sd, dst++, gLineData[i], SD_RAM_LINE_SZ)) return false;
+		}
 	}
+	
+	return true;
+}
 
-	sdSecWrite(sd, sec, b, addr%SD_BLOCK_SIZE + sz); // Write it
+Boolean ramFlush(SD* sd){
+	
+	UInt8 i;
+	Boolean ret = true;
+	
+	for(i = 0; i < SD_RAM_LINES; i++) if(!sdPrvRamEvict(sd, i)) ret = false;
+	
+	return ret;
 }
@@ -8,14 +8,19 @@
 typedef struct{
 	
 	UInt32 numSec;
+	UInt32 streamSec;	//next sector of the open multi-block read
 	UInt8 HC	: 1;
 	UInt8 inited	: 1;
 	UInt8 SD	: 1;
+	UInt8 stream	: 1;	//SD_STREAM_*
 	
 }SD;
 
 #define SD_BLOCK_SIZE		512
 
+#define SD_STREAM_NONE		0
+#define SD_STREAM_READ		1	//CMD18 open
+
 /*
 	Since atmega328p doesn't have enough pin for a real RAM, we
 	need to use virtual RAM on SD card.
@@ -29,24 +34,50 @@ typedef struct{
 	From SoC.c: #define RAM_SIZE	0x01000000UL	//16M @ 0xA0000000
 	So the virtual RAM size will be 16MB
 
-	The virtual RAM on the SD card will be store at the last sector
-	of the SD minus 32 sector.
-
-	The number of sector on the card can be returned by sdGetNumSec
-	function in SD.c, so the RAM start at sector sdGetNumSec - 33.
+	ramRead/ramWrite take an offset into that RAM and go through a
+	write-back cache of SD_RAM_LINES lines. Each line is stored in its
+	own sector, so the RAM occupies the last SD_RAM_SIZE / SD_RAM_LINE_SZ
+	sectors of the card (256MB with 32-byte lines). They return false on
+	a card error. Call ramFlush before the card is removed or power goes
+	away.
 */
 
+#define SD_RAM_SIZE		0x01000000UL
+
+#ifndef SD_RAM_LINES
+	#define SD_RAM_LINES	4	//at most 8, SRAM use is SD_RAM_LINES * (SD_RAM_LINE_SZ + 4)
+#endif
+
+#ifndef SD_RAM_LINE_SZ
+	#define SD_RAM_LINE_SZ	32	//power of two, at least ICACHE_LINE_SZ, at most SD_BLOCK_SIZE
+#endif
+
 // SD card pin
 #define SD_PIN_CS       (1 << PINB2) // Arduino UNO's digital pin 10
 #define SD_PIN_MOSI     (1 << PINB3) // Arduino UNO's digital pin 11
 #define SD_PIN_MISO     (1 << PINB4) // Arduino UNO's digital pin 12
 #define SD_PIN_SCLK     (1 << PINB5) // Arduino UNO's digital pin 13
 
+UInt8 sdSpiByte(UInt8 v);	//shared SPI bus, also used by the SPI RAM
 Boolean sdInit(SD* sd);
 UInt32 sdGetNumSec(SD* sd);
 Boolean sdSecRead(SD* sd, UInt32 sec, void* buf, UInt16 sz);
 Boolean sdSecWrite(SD* sd, UInt32 sec, UInt8* buf, UInt16 sz);
-void ramRead(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz);
-void ramWrite(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz);
+
+/*
+	Multi-block reads. A stream stays open between calls so runs of
+	consecutive sectors cost one command instead of one per sector. Any
+	single-block access (including ramRead/ramWrite) closes it first, so
+	only use them for runs with no RAM traffic in between.
+*/
+Boolean sdReadStart(SD* sd, UInt32 sec);				//CMD18
+Boolean sdReadNext(SD* sd, void* buf);					//one SD_BLOCK_SIZE block
+void sdStreamStop(SD* sd);						//CMD12
+Boolean sdStreamRead(SD* sd, UInt32 sec, void* buf);			//continue open read stream if sec follows on, else (re)start one
+
+Boolean ramRead(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz);
+Boolean ramWrite(SD* sd, UInt32 addr, UInt8* buf, UInt8 sz);
+Boolean ramLoad(SD* sd, UInt32 addr, UInt32 sec, UInt32 num);		//copy num card sectors from sec to RAM at addr, a multiple of SD_BLOCK_SIZE
+Boolean ramFlush(SD* sd);
 
 #endif
@@ -15,18 +15,70 @@ static const UInt8 embedded_boot[] PROGMEM = {
 #define RAM_BASE	0xA0000000UL
 #define RAM_SIZE	0x01000000UL	//16M @ 0xA0000000
 
+#define IDLE_MAX_SKIP	0x00100000UL	//cycles (~35ms), so the UARTs still get looked at now and then while idle
 
-static Boolean vMemF(ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged, UInt8* fsrP){
+
+static _INLINE_ Boolean vPrvMemF(ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged, UInt8* fsrP, _UNUSED_ Boolean fetch){
 	
 	SoC* soc = cpu->userData;
 	UInt32 pa;
 	
-	if(size & (size - 1)) return false; //size is not a power of two	
-	if(vaddr & (size - 1)) return false; //bad alignment
+	if(size > 8){	//burst: word aligned and inside one 1K page (the smallest there is) so one translation covers it
+		
+		if((size & 3) || (vaddr & 3) || ((vaddr ^ (vaddr + size - 1)) >> 10)) return false;
+	}
+	else{
+		
+		if(size & (size - 1)) return false; //size is not a power of two	
+		if(vaddr & (size - 1)) return false; //bad alignment
+	}
 
-	return mmuTranslate(&soc->mmu, vaddr, priviledged, write, &pa, fsrP) && memAccess(&soc->mem, pa, size, write, buf);
+	if(!mmuTranslate(&soc->mmu, vaddr, priviledged, write, &pa, fsrP)) return false;
+	if(pa - RAM_BASE >= RAM_SIZE) cpuStop(cpu);	//device access may move an event closer, socRun() must look before running on
+#ifndef EMBEDDED
+	if(fetch) memMarkCode(&soc->mem, pa);
+#endif
+	
+	return memAccess(&soc->mem, pa, size, write, buf);
 }
 
+static Boolean vMemF(ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged, UInt8* fsrP){
+	
+	return vPrvMemF(cpu, buf, vaddr, size, write, priviledged, fsrP, false);
+}
+
+#ifndef EMBEDDED
+
+	static Boolean vFetchF(ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged, UInt8* fsrP){
+		
+		return vPrvMemF(cpu, buf, vaddr, size, write, priviledged, fsrP, true);
+	}
+	
+	static void socPrvCodeWritten(void* userData, _UNUSED_ UInt32 pa){
+		
+		SoC* soc = userData;
+		
+		cpuCodeWritten(&soc->cpu);
+	}
+
+#endif
+
+#ifndef EMBEDDED
+
+	static UInt32* vPtrF(ArmCpu* cpu, UInt32 vaddr, UInt8 size, Boolean write, Boolean priviledged){
+		
+		SoC* soc = cpu->userData;
+		UInt32 pa;
+		UInt8 fsr;
+		
+		if((vaddr ^ (vaddr + size - 1)) >> 10) return NULL;	//one translation only covers the smallest page there is
+		if(!mmuTranslate(&soc->mmu, vaddr, priviledged, write, &pa, &fsr)) return NULL;	//memF will take the fault
+		
+		return memGetPtr(&soc->mem, pa, size, write);
+	}
+
+#endif
+
 static Boolean hyperF(ArmCpu* cpu){		//return true if handled
 
 	SoC* soc = cpu->userData;
@@ -36,6 +88,7 @@ static Boolean hyperF(ArmCpu* cpu){		//return true if handled
 		case 0:{
 
 			soc->go = false;
+			cpuStop(cpu);
 			break;
 		}
 		
@@ -91,7 +144,7 @@ static void emulErrF(const char* str){
 	while(1);
 }
 
-static Boolean pMemReadF(void* userData, UInt32* buf, UInt32 pa){	//for DMA engine and MMU pagetable walks
+static Boolean pMemReadF(void* userData, UInt32* buf, UInt32 pa){	//for MMU pagetable walks
 	return memAccess(userData, pa, 4, false, buf);
 }
 
@@ -114,7 +167,9 @@ static void socUartPrvWrite(UInt16 chr, void* userData){	//these are special fun
 
 void socRamModeCallout(SoC* soc, void* callout){
 	
-	if(!coRamInit(&soc->ram.coRAM, &soc->mem, RAM_BASE, RAM_SIZE, callout)) ERR("Cannot init coRAM");
+	RamCallout* co = callout;
+	
+	if(!coRamInit(&soc->ram.coRAM, &soc->mem, RAM_BASE, RAM_SIZE, co->accessF, co->userData)) ERR("Cannot init coRAM");
 	
 	soc->calloutMem = true;	
 }
@@ -130,6 +185,10 @@ void socInit(SoC* soc, SocRamAddF raF, void*raD, readcharF rc, writecharF wc, bl
 	
 	soc->blkF = blkF;
 	soc->blkD = blkD;
+	
+#ifndef EMBEDDED
+	soc->sleepF = NULL;
+#endif
 
 	soc->go = true;
 	
@@ -141,8 +200,15 @@ void socInit(SoC* soc, SocRamAddF raF, void*raD, readcharF rc, writecharF wc, bl
 		while(1);
 	}
 	soc->cpu.userData = soc;
+#ifndef EMBEDDED
+	cpuSetPtrF(&soc->cpu, vPtrF);
+	cpuSetFetchF(&soc->cpu, vFetchF);
+#endif
 	
 	memInit(&soc->mem);
+#ifndef EMBEDDED
+	memSetCodeWriteF(&soc->mem, socPrvCodeWritten, soc);
+#endif
 	mmuInit(&soc->mmu, pMemReadF, &soc->mem);
 	
 	if(ROM_SIZE > sizeof(soc->romMem)) {
@@ -154,40 +220,120 @@ void socInit(SoC* soc, SocRamAddF raF, void*raD, readcharF rc, writecharF wc, bl
 	
 	raF(soc, raD);
 	
-	if(!ramInit(&soc->ROM, &soc->mem, ROM_BASE, ROM_SIZE, soc->romMem)) ERR_("Cannot init ROM");
+	if(!ramInit(&soc->ROM, &soc->mem, ROM_BASE, sizeof(soc->romMem), soc->romMem)) ERR_("Cannot init ROM");
 	
 	cp15Init(&soc->cp15, &soc->cpu, &soc->mmu);
 	
 	__mem_copy(soc->romMem, embedded_boot, sizeof(embedded_boot));
 	
+	soc->cycles = 0;
+	
 	if(!pxa255icInit(&soc->ic, &soc->cpu, &soc->mem)) ERR_("IC error!");
-	//if(!pxa255timrInit(&soc->timr, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's OS timers");
-	//if(!pxa255rtcInit(&soc->rtc, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's RTC");
+	if(!pxa255timrInit(&soc->timr, &soc->mem, &soc->ic, &soc->cycles)) ERR_("Cannot init PXA255's OS timers");
 	if(!pxa255uartInit(&soc->ffuart, &soc->mem, &soc->ic,PXA255_FFUART_BASE, PXA255_I_FFUART)) ERR_("FFUART error!");
-	//if(!pxa255uartInit(&soc->btuart, &soc->mem, &soc->ic,PXA255_BTUART_BASE, PXA255_I_BTUART)) ERR_("Cannot init PXA255's BTUART");
-	//if(!pxa255uartInit(&soc->stuart, &soc->mem, &soc->ic,PXA255_STUART_BASE, PXA255_I_STUART)) ERR_("Cannot init PXA255's STUART");
-	//if(!pxa255pwrClkInit(&soc->pwrClk, &soc->cpu, &soc->mem)) ERR_("Cannot init PXA255's Power and Clock manager");
+#ifndef EMBEDDED
+	if(!pxa255uartInit(&soc->btuart, &soc->mem, &soc->ic,PXA255_BTUART_BASE, PXA255_I_BTUART)) ERR_("Cannot init PXA255's BTUART");
+	if(!pxa255uartInit(&soc->stuart, &soc->mem, &soc->ic,PXA255_STUART_BASE, PXA255_I_STUART)) ERR_("Cannot init PXA255's STUART");
+	if(!pxa255rtcInit(&soc->rtc, &soc->mem, &soc->ic, &soc->cycles, SOC_CYCLES_PER_SEC)) ERR_("Cannot init PXA255's RTC");
+#endif
+	if(!pxa255pwrClkInit(&soc->pwrClk, &soc->cpu, &soc->mem)) ERR_("Cannot init PXA255's Power and Clock manager");
 	//if(!pxa255gpioInit(&soc->gpio, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's GPIO controller");
-	//if(!pxa255dmaInit(&soc->dma, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's DMA controller");
-	//if(!pxa255dspInit(&soc->dsp, &soc->cpu)) ERR_("Cannot init PXA255's cp0 DSP");
-	//if(!pxa255lcdInit(&soc->lcd, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's LCD controller");
+#ifndef EMBEDDED
+	if(!pxa255dmaInit(&soc->dma, &soc->mem, &soc->ic)) ERR_("Cannot init PXA255's DMA controller");
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_FFUART_RX, pxa255uartDmaRxReq, &soc->ffuart);
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_FFUART_TX, pxa255uartDmaTxReq, &soc->ffuart);
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_BTUART_RX, pxa255uartDmaRxReq, &soc->btuart);
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_BTUART_TX, pxa255uartDmaTxReq, &soc->btuart);
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_STUART_RX, pxa255uartDmaRxReq, &soc->stuart);
+	pxa255dmaSetReqF(&soc->dma, PXA255_DMA_REQ_STUART_TX, pxa255uartDmaTxReq, &soc->stuart);
+#endif
+	if(!pxa255dspInit(&soc->dsp, &soc->cpu)) ERR_("Cannot init PXA255's cp0 DSP");	//on AVR too, as MAR/MRA only: linux's xscale_cp0_init probes acc0 with MAR and panics on the undefined instr
+#ifndef EMBEDDED
+	if(!pxa255lcdInit(&soc->lcd, &soc->mem, &soc->ic, &soc->cycles, SOC_CYCLES_PER_SEC)) ERR_("Cannot init PXA255's LCD controller");
+	if(!soc->calloutMem) pxa255lcdSetRam(&soc->lcd, &soc->ram.RAM);
+	vfpInit(&soc->vfp, &soc->cpu);
+#endif
 
 	pxa255uartSetFuncs(&soc->ffuart, socUartPrvRead, socUartPrvWrite, soc);	
 }
 
-void socRun(SoC* soc){
+static void socPrvPeriphProcess(SoC* soc, UInt32 cycles){
+
+	pxa255uartProcessCycles(&soc->ffuart, cycles);
+#ifndef EMBEDDED
+	pxa255uartProcessCycles(&soc->btuart, cycles);
+	pxa255uartProcessCycles(&soc->stuart, cycles);
+	pxa255dmaProcess(&soc->dma);
+#endif
+}
+
+static void socPrvIdle(SoC* soc){	//cpu waits for an interrupt: skip guest time ahead to just before the next timer, RTC or LCD event instead of running the idle loop
+	
+	UInt32 skip;
+	
+	if(soc->cpu.waitingIrqs || soc->cpu.waitingFiqs){	//already here (maybe masked), go handle it
+		
+		soc->cpu.sleeping = false;
+		return;
+	}
+#ifndef EMBEDDED
+	if(pxa255dmaProcess(&soc->dma)) return;		//let DMA finish (it is probably what the cpu waits on) before skipping far ahead
+#endif
+	
+	skip = soc->timr.due - soc->cycles - 1;
+#ifndef EMBEDDED
+	if(soc->rtc.due - soc->cycles - 1 < skip) skip = soc->rtc.due - soc->cycles - 1;
+	if(soc->lcd.due - soc->cycles - 1 < skip) skip = soc->lcd.due - soc->cycles - 1;
+#endif
+	if(skip > IDLE_MAX_SKIP) skip = IDLE_MAX_SKIP;
+#ifndef EMBEDDED
+	if(soc->sleepF) skip = soc->sleepF(soc->sleepD, skip);
+#endif
 	
-	UInt32 cycles = 0;	//make 64 if you REALLY need it... later
+	soc->cycles += skip;
+	socPrvPeriphProcess(soc, skip);
+}
+
+#ifndef EMBEDDED
+
+	void socSetSleepF(SoC* soc, SocSleepF sleepF, void* userData){
+		
+		soc->sleepF = sleepF;
+		soc->sleepD = userData;
+	}
+
+#endif
+
+static UInt32 socPrvQuietCycles(SoC* soc){	//cycles from now till the next event, this one included. the cpu can run them in one go
+
+	UInt32 n = 0x100 - (soc->cycles & 0x0000FFUL), t;
+	
+	t = soc->timr.due - soc->cycles;
+	if(t && t < n) n = t;
+#ifndef EMBEDDED
+	t = soc->rtc.due - soc->cycles;
+	if(t && t < n) n = t;
+	t = soc->lcd.due - soc->cycles;
+	if(t && t < n) n = t;
+#endif
+	
+	return n;
+}
+
+void socRun(SoC* soc){
 	
 	while(soc->go){
 		
-		cycles++;	
+		soc->cycles++;
 		
-		//if(!(cycles & 0x000007UL)) pxa255timrTick(&soc->timr);
-		if(!(cycles & 0x0000FFUL)) pxa255uartProcess(&soc->ffuart);
-		//if(!(cycles & 0x000FFFUL)) pxa255rtcUpdate(&soc->rtc);
-		//if(!(cycles & 0x01FFFFUL)) pxa255lcdFrame(&soc->lcd);
+		if(soc->cycles == soc->timr.due) pxa255timrUpdate(&soc->timr);
+		if(!(soc->cycles & 0x0000FFUL)) socPrvPeriphProcess(soc, 0x100);
+	#ifndef EMBEDDED
+		if(soc->cycles == soc->rtc.due) pxa255rtcUpdate(&soc->rtc);
+		if(soc->cycles == soc->lcd.due) pxa255lcdFrame(&soc->lcd);
+	#endif
 		
-		cpuCycle(&soc->cpu);
+		if(soc->cpu.sleeping) socPrvIdle(soc);
+		else cpuRun(&soc->cpu, &soc->cycles, socPrvQuietCycles(soc));
 	}
 }
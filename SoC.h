@@ -22,19 +22,25 @@ typedef int (*blockOp)(void* data, UInt32 sec, void* ptr, UInt8 op);
 struct SoC;
 
 typedef void (*SocRamAddF)(struct SoC* soc, void* data);
+typedef UInt32 (*SocSleepF)(void* userData, UInt32 cycles);	//guest idles for up to "cycles", block till then or till input arrives, return cycles that passed
 
 typedef struct{
 	
-	UInt32 (*WordGet)(UInt32 wordAddr);
-	void (*WordSet)(UInt32 wordAddr, UInt32 val);
+	Boolean (*accessF)(void* userData, UInt32 ofst, UInt8 size, Boolean write, void* buf);	//ofst is from the start of RAM, size may be a burst
+	void* userData;
 	
 }RamCallout;
 
 void socRamModeAlloc(struct SoC* soc, void* ignored);
-void socRamModeCallout(struct SoC* soc, void* callout);	//rally pointer to RamCallout
+void socRamModeCallout(struct SoC* soc, void* callout);	//really pointer to RamCallout
 
 void socInit(struct SoC* soc, SocRamAddF raF, void* raD, readcharF rc, writecharF wc, blockOp blkF, void* blkD);
 void socRun(struct SoC* soc);
+#ifndef EMBEDDED
+	void socSetSleepF(struct SoC* soc, SocSleepF sleepF, void* userData);	//without one idle time is skipped as fast as possible
+#endif
+
+#define SOC_CYCLES_PER_SEC	(3686400UL << PXA255_TIMR_TICK_SHIFT)	//a guest second as the OS timer counts it
 
 extern volatile UInt32 gRtc;	//needed by SoC
 
@@ -47,6 +53,13 @@ extern volatile UInt32 gRtc;	//needed by SoC
 #include "math64.h"
 #include "pxa255_IC.h"
 #include "pxa255_UART.h"
+#include "pxa255_TIMR.h"
+#include "pxa255_RTC.h"
+#include "pxa255_DMA.h"
+#include "pxa255_LCD.h"
+#include "pxa255_PwrClk.h"
+#include "pxa255_DSP.h"
+#include "vfp.h"
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 
@@ -58,6 +71,11 @@ typedef struct SoC{
 	blockOp blkF;
 	void* blkD;
 	
+#ifndef EMBEDDED
+	SocSleepF sleepF;
+	void* sleepD;
+#endif
+	
 	UInt32 blkDevBuf[BLK_DEV_BLK_SZ / 4];
 
 	union{
@@ -70,13 +88,26 @@ typedef struct SoC{
 	ArmMem mem;
 	ArmCP15 cp15;
 	Pxa255ic ic;
+	Pxa255timr timr;
+	Pxa255pwrClk pwrClk;
+	Pxa255dsp dsp;		//every build: the kernel will not boot without cp0
 	Pxa255uart ffuart;
+#ifndef EMBEDDED
+	Pxa255uart btuart;
+	Pxa255uart stuart;
+	Pxa255rtc rtc;
+	Pxa255dma dma;
+	Pxa255lcd lcd;
+	ArmVfp vfp;
+#endif
+	
+	UInt32 cycles;		//guest time, wraps
 	
 	UInt8 go	:1;
 	UInt8 calloutMem:1;
 	
-	//space for embeddedBoot
-	UInt32 romMem[13];
+	//space for embeddedBoot, whole icache lines since fills are bursts that must stay inside the region
+	UInt32 romMem[16];
 
 }SoC;
 
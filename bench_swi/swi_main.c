@@ -0,0 +1,86 @@
+/*
+	SWI storm: times exception entry and return on the bare cpu core, no SoC
+
+	the guest drops to user mode and loops "SWI 0 ; SUBS r0, r0, #1 ; BNE" while the
+	SWI vector returns at once with "MOVS pc, lr", so every iteration is one switch
+	to SVC and one back. build with "make" in this directory, run "./swiStorm [count]"
+	(default 4M) and compare the time before and after a change to mode switching.
+	like the rest of the tree it needs UInt32 to be 4 bytes: on LP64 hosts types.h's
+	"unsigned long" has to become "unsigned int" first, else it times nothing.
+*/
+
+#include "../CPU.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static UInt32 gMem[64];
+
+static const UInt32 gCode[] = {
+
+	0xEA000006,	//00: reset:	B start
+	0xE1A00000,	//04: und:	NOP
+	0xE1B0F00E,	//08: swi:	MOVS pc, lr
+	0xE1A00000,	//0C
+	0xE1A00000,	//10
+	0xE1A00000,	//14
+	0xE1A00000,	//18
+	0xE1A00000,	//1C
+	0xE1A00000,	//20: start:	NOP
+	0xE1A00000,	//24:		NOP
+	0xE1A00000,	//28:		NOP
+	0xE321F010,	//2C:		MSR cpsr_c, #0x10	(user mode)
+	0xEF000000,	//30: loop:	SWI 0
+	0xE2500001,	//34:		SUBS r0, r0, #1
+	0x1AFFFFFC,	//38:		BNE loop
+	0xEAFFFFFE,	//3C: done:	B done
+};
+
+static Boolean swiMemF(_UNUSED_ ArmCpu* cpu, void* buf, UInt32 vaddr, UInt8 size, Boolean write, _UNUSED_ Boolean priviledged, _UNUSED_ UInt8* fsr){
+
+	UInt8* m = (UInt8*)gMem + vaddr;
+	UInt8* b = buf;
+
+	if(vaddr >= sizeof(gMem) || sizeof(gMem) - vaddr < size) return false;
+	while(size--){
+		if(write) *m++ = *b++;
+		else *b++ = *m++;
+	}
+	return true;
+}
+
+static Boolean swiHypercallF(_UNUSED_ ArmCpu* cpu){
+
+	return false;
+}
+
+static void swiEmulErrF(_UNUSED_ ArmCpu* cpu, const char* str){
+
+	fprintf(stderr, "%s\n", str);
+	exit(-1);
+}
+
+void err_str(const char* str){
+
+	fputs(str, stderr);
+}
+
+int main(int argc, char** argv){
+
+	UInt32 i, n = argc > 1 ? strtoul(argv[1], NULL, 0) : 4000000UL;
+	struct timespec start, end;
+	ArmCpu cpu;
+
+	for(i = 0; i < sizeof(gCode) / sizeof(*gCode); i++) gMem[i] = gCode[i];
+	cpuInit(&cpu, 0, swiMemF, swiEmulErrF, swiHypercallF, NULL);
+	cpu.regs[0] = n;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while(cpu.regs[15] != 0x3C) cpuCycle(&cpu);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%lu SWIs: %.3fs\n", (unsigned long)n, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	return 0;
+}
@@ -2,12 +2,21 @@
 #include "callout_RAM.h"
 
 
-Boolean coRamInit(CalloutRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, ArmMemAccessF* coF){
+static Boolean coRamPrvAccess(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+	
+	CalloutRam* ram = userData;
+	
+	return ram->aF(ram->uD, pa - ram->adr, size, write, buf);
+}
+
+Boolean coRamInit(CalloutRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, CalloutRamAccessF aF, void* uD){
 
 	ram->adr = adr;
 	ram->sz = sz;
+	ram->aF = aF;
+	ram->uD = uD;
 	
-	return memRegionAdd(mem, adr, sz, (void*)coF, ram);	
+	return memRegionAddBurst(mem, adr, sz, coRamPrvAccess, ram);	
 }
 
 Boolean coRamDeinit(CalloutRam* ram, ArmMem* mem){
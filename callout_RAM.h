@@ -5,15 +5,19 @@
 #include "types.h"
 #include "mem.h"
 
+typedef Boolean (*CalloutRamAccessF)(void* userData, UInt32 ofst, UInt8 size, Boolean write, void* buf);	//ofst is from the start of the region
+
 typedef struct{
 
 	UInt32 adr;
 	UInt32 sz;
+	CalloutRamAccessF aF;
+	void* uD;
 
 }CalloutRam;
 
 
-Boolean coRamInit(CalloutRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, ArmMemAccessF* coF);
+Boolean coRamInit(CalloutRam* ram, ArmMem* mem, UInt32 adr, UInt32 sz, CalloutRamAccessF aF, void* uD);
 Boolean coRamDeinit(CalloutRam* ram, ArmMem* mem);
 
 #endif
@@ -0,0 +1,146 @@
+#include "cowDisk.h"
+#include "SoC.h"
+#include "rt.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+
+static Boolean cowPrvWrite(FILE* f, off64_t pos, const void* buf, UInt32 sz){
+
+	if(fseeko64(f, pos, SEEK_SET)) return false;
+	return fwrite(buf, 1, sz, f) == sz;
+}
+
+static Boolean cowPrvRead(FILE* f, off64_t pos, void* buf, UInt32 sz){
+
+	if(fseeko64(f, pos, SEEK_SET)) return false;
+	return fread(buf, 1, sz, f) == sz;
+}
+
+static Boolean cowPrvSync(FILE* f){		//to the disk, not just out of stdio
+
+	return !fflush(f) && !fsync(fileno(f));
+}
+
+static Boolean cowPrvWriteHdr(CowDisk* cow){
+
+	CowHdr hdr;
+
+	hdr.magic = COW_MAGIC;
+	hdr.blkSz = BLK_DEV_BLK_SZ;
+	hdr.numBlks = cow->numBlks;
+	hdr.numUsed = cow->numUsed;
+
+	return cowPrvWrite(cow->ovl, 0, &hdr, sizeof(hdr));
+}
+
+Boolean cowDiskOpen(CowDisk* cow, const char* basePath, const char* ovlPath){
+
+	UInt32 i, idxSz, maxSlot;
+	off64_t len;
+	CowHdr hdr;
+
+	cow->base = fopen64(basePath, "rb");
+	if(!cow->base){
+		err_str("Failed to open base image\n");
+		return false;
+	}
+	if(fseeko64(cow->base, 0, SEEK_END)) goto fail_base;
+	len = ftello64(cow->base);
+	if(len < 0) goto fail_base;
+	cow->numBlks = len / BLK_DEV_BLK_SZ;
+
+	idxSz = cow->numBlks * sizeof(UInt32);
+	cow->dataOfst = ((off64_t)sizeof(CowHdr) + idxSz + BLK_DEV_BLK_SZ - 1) / BLK_DEV_BLK_SZ * BLK_DEV_BLK_SZ;
+	cow->index = calloc(cow->numBlks ? cow->numBlks : 1, sizeof(UInt32));
+	if(!cow->index) goto fail_base;
+
+	cow->ovl = fopen64(ovlPath, "r+b");
+	if(!cow->ovl){		//new overlay: header + all-zero index
+
+		cow->ovl = fopen64(ovlPath, "w+b");
+		if(!cow->ovl){
+			err_str("Failed to create overlay\n");
+			goto fail_idx;
+		}
+		cow->numUsed = 0;
+		if(!cowPrvWriteHdr(cow) || !cowPrvWrite(cow->ovl, sizeof(CowHdr), cow->index, idxSz)) goto fail_ovl;
+		fflush(cow->ovl);
+		return true;
+	}
+
+	if(!cowPrvRead(cow->ovl, 0, &hdr, sizeof(hdr)) || hdr.magic != COW_MAGIC || hdr.blkSz != BLK_DEV_BLK_SZ){
+		err_str("Overlay header invalid\n");
+		goto fail_ovl;
+	}
+	if(hdr.numBlks != cow->numBlks){
+		err_str("Overlay does not match base image size\n");
+		goto fail_ovl;
+	}
+	if(!cowPrvRead(cow->ovl, sizeof(CowHdr), cow->index, idxSz)) goto fail_ovl;
+
+	//a crash between the index entry and the header leaves numUsed behind: rebuild it from the index. entries past the data are real corruption
+	maxSlot = hdr.numUsed;
+	for(i = 0; i < cow->numBlks; i++) if(cow->index[i] > maxSlot) maxSlot = cow->index[i];
+	if(fseeko64(cow->ovl, 0, SEEK_END) || (len = ftello64(cow->ovl)) < 0) goto fail_ovl;
+	for(i = 0; i < cow->numBlks; i++) if(cow->index[i] && cow->dataOfst + (off64_t)cow->index[i] * BLK_DEV_BLK_SZ > len){
+		err_str("Overlay index corrupt\n");
+		goto fail_ovl;
+	}
+	cow->numUsed = maxSlot;
+	if(maxSlot != hdr.numUsed && (!cowPrvWriteHdr(cow) || !cowPrvSync(cow->ovl))) goto fail_ovl;
+	return true;
+
+fail_ovl:
+	fclose(cow->ovl);
+fail_idx:
+	free(cow->index);
+fail_base:
+	fclose(cow->base);
+	return false;
+}
+
+void cowDiskClose(CowDisk* cow){
+
+	fclose(cow->ovl);
+	fclose(cow->base);
+	free(cow->index);
+}
+
+int cowDiskOps(void* userData, UInt32 sector, void* buf, UInt8 op){
+
+	CowDisk* cow = userData;
+	UInt32 slot;
+
+	switch(op){
+		case BLK_OP_SIZE:
+
+			if(sector == 0) *(unsigned long*)buf = cow->numBlks;		//num blocks
+			else if(sector == 1) *(unsigned long*)buf = BLK_DEV_BLK_SZ;	//block size
+			else return 0;
+			return 1;
+
+		case BLK_OP_READ:
+
+			if(sector >= cow->numBlks) return false;
+			slot = cow->index[sector];
+			if(slot) return cowPrvRead(cow->ovl, cow->dataOfst + (off64_t)(slot - 1) * BLK_DEV_BLK_SZ, buf, BLK_DEV_BLK_SZ);
+			return cowPrvRead(cow->base, (off64_t)sector * BLK_DEV_BLK_SZ, buf, BLK_DEV_BLK_SZ);
+
+		case BLK_OP_WRITE:
+
+			if(sector >= cow->numBlks) return false;
+			slot = cow->index[sector];
+			if(slot) return cowPrvWrite(cow->ovl, cow->dataOfst + (off64_t)(slot - 1) * BLK_DEV_BLK_SZ, buf, BLK_DEV_BLK_SZ);
+
+			//first write to this block: data, then index entry, then header, each synced before the next so a crash
+			//never leaves the index pointing at garbage. a stale numUsed is rebuilt from the index on open
+			slot = cow->numUsed + 1;
+			if(!cowPrvWrite(cow->ovl, cow->dataOfst + (off64_t)(slot - 1) * BLK_DEV_BLK_SZ, buf, BLK_DEV_BLK_SZ) || !cowPrvSync(cow->ovl)) return false;
+			if(!cowPrvWrite(cow->ovl, sizeof(CowHdr) + (off64_t)sector * sizeof(UInt32), &slot, sizeof(UInt32)) || !cowPrvSync(cow->ovl)) return false;
+			cow->numUsed = slot;
+			cow->index[sector] = slot;
+			return cowPrvWriteHdr(cow) && cowPrvSync(cow->ovl);
+	}
+	return 0;
+}
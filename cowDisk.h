@@ -0,0 +1,49 @@
+#ifndef _COW_DISK_H_
+#define _COW_DISK_H_
+
+#include "types.h"
+#include <stdio.h>
+
+/*
+	Copy-on-write overlay disk (host builds only).
+
+	The base image is opened read-only and may be shared by any number of
+	emulator instances. Every block the guest writes goes to the overlay file:
+
+		CowHdr
+		UInt32 index[numBlks]	//0 = block lives in base, else 1-based slot number
+		(pad to block size)
+		slots, BLK_DEV_BLK_SZ bytes each, in order of first write
+
+	The index is kept in memory so reads are a single array lookup.
+*/
+
+#define COW_MAGIC	0x31574F43UL	//"COW1"
+
+typedef struct{
+
+	UInt32 magic;
+	UInt32 blkSz;
+	UInt32 numBlks;
+	UInt32 numUsed;
+
+}CowHdr;
+
+typedef struct{
+
+	FILE* base;
+	FILE* ovl;
+
+	UInt32* index;
+	UInt32 numBlks;
+	UInt32 numUsed;
+
+	off64_t dataOfst;
+
+}CowDisk;
+
+Boolean cowDiskOpen(CowDisk* cow, const char* basePath, const char* ovlPath);
+void cowDiskClose(CowDisk* cow);
+int cowDiskOps(void* userData, UInt32 sector, void* buf, UInt8 op);	//blockOp
+
+#endif
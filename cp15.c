@@ -4,6 +4,227 @@
 #define CPUID_PXA255		0x69052D06UL	//spepping A0
 #define CPUID_PXA270		0x69054114UL	//stepping C0
 
+#ifdef CP15_REG_TABLE
+
+static Boolean cp15prvMainId(_UNUSED_ ArmCP15* cp15, _UNUSED_ Boolean read, UInt32* val){	//writes to ID codes are ignored
+	
+	*val = CPUID_PXA255;
+	return true;
+}
+
+static Boolean cp15prvCacheType(_UNUSED_ ArmCP15* cp15, _UNUSED_ Boolean read, UInt32* val){	//we lie here
+	
+	*val = 0x0B16A16AUL;
+	return true;
+}
+
+static Boolean cp15prvControl(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	UInt32 tmp;
+	
+	if(read){
+		*val = cp15->control;
+		return true;
+	}
+	
+	tmp = *val ^ cp15->control;		//see what changed and mask off then chack for what we support changing of
+	if(tmp & 0x84F0UL){
+		//err_str("cp15: unknown bits changed 0x");
+		//err_hex(cp15->control);
+		//err_str("->0x");
+		//err_hex(*val);
+		//err_str(", halting\r\n");
+		while(true);
+	}
+	
+	if(tmp & 0x00002000UL){			// V bit
+		
+		cpuSetVectorAddr(cp15->cpu, (*val & 0x00002000UL) ? 0xFFFF0000UL : 0x00000000UL);
+		cp15->control ^= 0x00002000UL;
+	}
+	if(tmp & 0x00000200UL){			// R bit
+		
+		mmuSetR(cp15->mmu, (*val & 0x00000200UL) != 0);
+		cpuMapChanged(cp15->cpu);
+		cp15->control ^= 0x00000200UL;
+	}
+	if(tmp & 0x00000100UL){			// S bit
+		
+		mmuSetS(cp15->mmu, (*val & 0x00000100UL) != 0);
+		cpuMapChanged(cp15->cpu);
+		cp15->control ^= 0x00000100UL;
+	}
+	if(tmp & 0x00000001UL){			// M bit
+		
+		mmuSetTTP(cp15->mmu, (*val & 0x00000001UL) ? cp15->ttb : MMU_DISABLED_TTP);
+		mmuTlbFlush(cp15->mmu);
+		cpuMapChanged(cp15->cpu);
+		cp15->control ^= 0x00000001UL;
+	}
+	return true;
+}
+
+static Boolean cp15prvAuxControl(ArmCP15* cp15, Boolean read, UInt32* val){	//PXA-specific thing
+	
+	if(read) *val = cp15->ACP;
+	else cp15->ACP = *val;
+	return true;
+}
+
+static Boolean cp15prvTtb(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	if(read) *val = cp15->ttb;
+	else{
+		if(cp15->control & 0x00000001UL){	//mmu is on
+			
+			mmuSetTTP(cp15->mmu, *val);
+			mmuTlbFlush(cp15->mmu);
+			cpuMapChanged(cp15->cpu);
+		}
+		cp15->ttb = *val;
+	}
+	return true;
+}
+
+static Boolean cp15prvDomains(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	if(read) *val = mmuGetDomainCfg(cp15->mmu);
+	else{
+		mmuSetDomainCfg(cp15->mmu, *val);
+		cpuMapChanged(cp15->cpu);
+	}
+	return true;
+}
+
+static Boolean cp15prvFsr(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	if(read) *val = cp15->FSR;
+	else cp15->FSR = *val;
+	return true;
+}
+
+static Boolean cp15prvFar(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	if(read) *val = cp15->FAR;
+	else cp15->FAR = *val;
+	return true;
+}
+
+static Boolean cp15prvWaitForInt(ArmCP15* cp15, _UNUSED_ Boolean read, _UNUSED_ UInt32* val){
+	
+	cpuSleep(cp15->cpu);
+	return true;
+}
+
+static Boolean cp15prvIcacheInval(ArmCP15* cp15, _UNUSED_ Boolean read, _UNUSED_ UInt32* val){
+	
+	cpuIcacheInval(cp15->cpu);
+	return true;
+}
+
+static Boolean cp15prvIcacheInvalAddr(ArmCP15* cp15, _UNUSED_ Boolean read, UInt32* val){
+	
+	cpuIcacheInvalAddr(cp15->cpu, *val);
+	return true;
+}
+
+static Boolean cp15prvTlbFlush(ArmCP15* cp15, _UNUSED_ Boolean read, _UNUSED_ UInt32* val){
+	
+	mmuTlbFlush(cp15->mmu);
+	cpuMapChanged(cp15->cpu);
+	return true;
+}
+
+static Boolean cp15prvNop(_UNUSED_ ArmCP15* cp15, _UNUSED_ Boolean read, _UNUSED_ UInt32* val){	//dcache, write buffer and lockdown ops: we have none of those
+	
+	return true;
+}
+
+static Boolean cp15prvCpar(ArmCP15* cp15, Boolean read, UInt32* val){
+	
+	if(read) *val = cpuGetCPAR(cp15->cpu);
+	else cpuSetCPAR(cp15->cpu, *val & 0x3FFF);
+	return true;
+}
+
+static ArmCP15RegF cp15prvResolve(Boolean read, UInt8 CRn, UInt8 CRm, UInt8 op2){	//NULL if there is no such register (or op)
+	
+	switch(CRn){
+		
+		case 0:		//ID codes
+		
+			if(!read) return CRm ? NULL : cp15prvMainId;		//cannot write to ID codes register and CRm must be zero for this read
+			return op2 ? cp15prvCacheType : cp15prvMainId;
+			
+		case 1:		//control register
+		
+			if(!op2) return cp15prvControl;
+			if(op2 == 1) return cp15prvAuxControl;
+			break;
+			
+		case 2:		//translation tabler base
+			return cp15prvTtb;
+		
+		case 3:		//domain access control
+			return cp15prvDomains;
+		
+		case 5:		//FSR
+			return cp15prvFsr;
+			
+		case 6:		//FAR
+			return cp15prvFar;
+		
+		case 7:		//cache ops
+			if(CRm == 0 && op2 == 4) return cp15prvWaitForInt;					//wait for interrupt
+			if((CRm == 5 || CRm == 7) && op2 == 0) return cp15prvIcacheInval;		//invalidate entire {icache(5) or both i and dcache(7)}
+			if((CRm == 5 || CRm == 7) && op2 == 1) return cp15prvIcacheInvalAddr;	//invalidate {icache(5) or both i and dcache(7)} line, given VA
+			if((CRm == 5 || CRm == 7) && op2 == 2) return cp15prvIcacheInval;		//invalidate {icache(5) or both i and dcache(7)} line, given set/index. i dont know how to do this, so flush thee whole thing
+			return cp15prvNop;
+		
+		case 8:		//TLB ops
+			return cp15prvTlbFlush;
+		
+		case 9:		//cache lockdown
+			return cp15prvNop;
+		
+		case 10:	//TLB lockdown
+			return cp15prvNop;
+		
+		case 13:	//FCSE
+			//err_str("FCSE not supported\n");
+			break;
+		
+		case 15:
+			if(op2 == 0 && CRm == 1) return cp15prvCpar;	//CPAR
+			break;
+	}
+	
+	return NULL;
+}
+
+static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+	
+	ArmCP15* cp15 = userData;
+	ArmCP15RegF f;
+	UInt32 val = 0;
+	
+	if(op1 != 0 || two) return false;				//CP15 only accessed with MCR/MRC with op1 == 0
+	
+	f = cp15->regRow[CRn][CP15_REG_KEY(read, CRm, op2) & cp15->regMask[CRn]];
+	if(!f) return false;						//undefined instr
+	
+	if(!read) val = (Rx == 15) ? cpuGetRegExternal(cpu, Rx) : cpu->regs[Rx];	//PC is the only register the cpu needs to be asked about
+	if(!f(cp15, read, &val)) return false;
+	
+	if(read){
+		if(Rx == 15) cpuSetReg(cpu, Rx, val);
+		else cpu->regs[Rx] = val;
+	}
+	return true;
+}
+
+#else
+
 static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
 	
 	ArmCP15* cp15 = userData;
@@ -56,17 +277,20 @@ static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Bool
 					if(tmp & 0x00000200UL){			// R bit
 						
 						mmuSetR(cp15->mmu, (val & 0x00000200UL) != 0);
+						cpuMapChanged(cp15->cpu);
 						cp15->control ^= 0x00000200UL;
 					}
 					if(tmp & 0x00000100UL){			// S bit
 						
 						mmuSetS(cp15->mmu, (val & 0x00000100UL) != 0);
+						cpuMapChanged(cp15->cpu);
 						cp15->control ^= 0x00000100UL;
 					}
 					if(tmp & 0x00000001UL){			// M bit
 						
 						mmuSetTTP(cp15->mmu, (val & 0x00000001UL) ? cp15->ttb : MMU_DISABLED_TTP);
 						mmuTlbFlush(cp15->mmu);
+						cpuMapChanged(cp15->cpu);
 						cp15->control ^= 0x00000001UL;
 					}
 					
@@ -86,6 +310,7 @@ static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Bool
 					
 					mmuSetTTP(cp15->mmu, val);
 					mmuTlbFlush(cp15->mmu);
+					cpuMapChanged(cp15->cpu);
 				}
 				cp15->ttb = val;
 			}
@@ -93,7 +318,10 @@ static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Bool
 		
 		case 3:		//domain access control
 			if(read) val = mmuGetDomainCfg(cp15->mmu);
-			else mmuSetDomainCfg(cp15->mmu, val);
+			else{
+				mmuSetDomainCfg(cp15->mmu, val);
+				cpuMapChanged(cp15->cpu);
+			}
 			goto success;
 		
 		case 5:		//FSR
@@ -107,6 +335,7 @@ static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Bool
 			goto success;
 		
 		case 7:		//cache ops
+			if(CRm == 0 && op2 == 4) cpuSleep(cp15->cpu);					//wait for interrupt
 			if((CRm == 5 || CRm == 7)&& op2 == 0) cpuIcacheInval(cp15->cpu);		//invalidate entire {icache(5) or both i and dcache(7)}
 			if((CRm == 5 || CRm == 7) && op2 == 1) cpuIcacheInvalAddr(cp15->cpu, val);	//invalidate {icache(5) or both i and dcache(7)} line, given VA
 			if((CRm == 5 || CRm == 7) && op2 == 2) cpuIcacheInval(cp15->cpu);		//invalidate {icache(5) or both i and dcache(7)} line, given set/index. i dont know how to do this, so flush thee whole thing
@@ -114,6 +343,7 @@ static Boolean cp15prvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Bool
 		
 		case 8:		//TLB ops
 			mmuTlbFlush(cp15->mmu);
+			cpuMapChanged(cp15->cpu);
 			goto success;
 		
 		case 9:		//cache lockdown
@@ -145,9 +375,16 @@ success:
 	return true;
 }
 
+#endif
+
 void cp15Init(ArmCP15* cp15, ArmCpu* cpu, ArmMmu* mmu){
 
 	ArmCoprocessor cp;
+#ifdef CP15_REG_TABLE
+	ArmCP15RegF f;
+	UInt8 CRn, rows = 0;
+	UInt16 key;
+#endif
 	
 	cp.regXfer = cp15prvCoprocRegXferFunc;
 	cp.dataProcessing = NULL;
@@ -160,6 +397,29 @@ void cp15Init(ArmCP15* cp15, ArmCpu* cpu, ArmMmu* mmu){
 	cp15->mmu = mmu;
 	cp15->control = 0x00004072UL;
 	
+#ifdef CP15_REG_TABLE
+	for(CRn = 0; CRn < 16; CRn++){
+		
+		f = cp15prvResolve(false, CRn, 0, 0);
+		for(key = 0; key < CP15_REG_ROW_KEYS && cp15prvResolve(CP15_REG_KEY_READ(key), CRn, CP15_REG_KEY_CRM(key), CP15_REG_KEY_OP2(key)) == f; key++);
+		
+		if(key == CP15_REG_ROW_KEYS){		//one handler for all of this CRn
+			
+			cp15->regOne[CRn] = f;
+			cp15->regRow[CRn] = cp15->regOne + CRn;
+			cp15->regMask[CRn] = 0;
+			continue;
+		}
+		if(rows == CP15_REG_ROWS){
+			err_str("cp15: CP15_REG_ROWS too small\r\n");
+			while(true);
+		}
+		for(key = 0; key < CP15_REG_ROW_KEYS; key++) cp15->regRows[rows][key] = cp15prvResolve(CP15_REG_KEY_READ(key), CRn, CP15_REG_KEY_CRM(key), CP15_REG_KEY_OP2(key));
+		cp15->regRow[CRn] = cp15->regRows[rows++];
+		cp15->regMask[CRn] = CP15_REG_ROW_KEYS - 1;
+	}
+#endif
+	
 	cpuCoprocessorRegister(cpu, 15, &cp);
 }
 
@@ -6,7 +6,22 @@
 #include "CPU.h"
 #include "MMU.h"
 
-typedef struct{
+#ifndef EMBEDDED
+	#define CP15_REG_TABLE		//MCR/MRC handlers picked once per register at init, found by CRn then by the rest, not decoded every access
+#endif
+
+#define CP15_REG_ROWS			4	//CRn values whose handler depends on more than CRn (0, 1, 7 and 15), each costs a row
+#define CP15_REG_ROW_KEYS		256	//MRC/MCR, CRm, op2 (op1 is always 0)
+#define CP15_REG_KEY(read, CRm, op2)	(((read) ? 0x80 : 0) | ((CRm) << 3) | (op2))
+#define CP15_REG_KEY_READ(key)		(((key) & 0x80) != 0)
+#define CP15_REG_KEY_CRM(key)		(((key) >> 3) & 0x0F)
+#define CP15_REG_KEY_OP2(key)		((key) & 0x07)
+
+struct ArmCP15;
+
+typedef Boolean (*ArmCP15RegF)(struct ArmCP15* cp15, Boolean read, UInt32* val);	//MRC fills *val, MCR gives it
+
+typedef struct ArmCP15{
 
 	ArmCpu* cpu;
 	ArmMmu* mmu;
@@ -17,6 +32,13 @@ typedef struct{
 	UInt32 FAR;	//fault address register
 	UInt32 CPAR;	//coprocessor access register
 	UInt32 ACP;	//auxilary control reg for xscale
+	
+#ifdef CP15_REG_TABLE
+	const ArmCP15RegF* regRow[16];		//by CRn: a row of regRows, or its entry in regOne
+	UInt8 regMask[16];			//applied to CP15_REG_KEY(): all of it for a row, 0 for one entry
+	ArmCP15RegF regOne[16];
+	ArmCP15RegF regRows[CP15_REG_ROWS][CP15_REG_ROW_KEYS];	//NULL for no such register
+#endif
 }ArmCP15;
 
 void cp15Init(ArmCP15* cp15, ArmCpu* cpu, ArmMmu* mmu);
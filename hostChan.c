@@ -0,0 +1,178 @@
+#include "hostChan.h"
+#include "pxa255_UART.h"
+#include "rt.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+static int hostChanPrvOpenFifo(const char* base, const char* ext, int flags){
+
+	char path[256];
+
+	if(snprintf(path, sizeof(path), "%s%s", base, ext) >= (int)sizeof(path)) return -1;
+	if(mkfifo(path, 0600) && errno != EEXIST) return -1;
+
+	return open(path, flags);	//O_RDWR: never blocks on open and never sees EOF when the other side goes away. O_NONBLOCK: a stalled reader never stalls us
+}
+
+Boolean hostChanOpen(HostChan* ch, const char* spec){
+
+	ch->listenFd = -1;
+	ch->inFd = -1;
+	ch->outFd = -1;
+	ch->outLen = 0;
+	ch->inPos = 0;
+	ch->inLen = 0;
+	ch->idle = 0;
+	ch->written = false;
+
+	if(!strncmp(spec, "unix:", 5)){
+
+		struct sockaddr_un sa;
+
+		spec += 5;
+		if(strlen(spec) >= sizeof(sa.sun_path)) return false;
+
+		sa.sun_family = AF_UNIX;
+		strcpy(sa.sun_path, spec);
+		unlink(spec);
+
+		ch->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(ch->listenFd < 0) return false;
+		if(bind(ch->listenFd, (struct sockaddr*)&sa, sizeof(sa)) || listen(ch->listenFd, 1) || fcntl(ch->listenFd, F_SETFL, O_NONBLOCK)){
+
+			close(ch->listenFd);
+			return false;
+		}
+		return true;
+	}
+	else if(!strncmp(spec, "fifo:", 5)){
+
+		spec += 5;
+		ch->inFd = hostChanPrvOpenFifo(spec, ".in", O_RDWR | O_NONBLOCK);
+		ch->outFd = hostChanPrvOpenFifo(spec, ".out", O_RDWR | O_NONBLOCK);
+		if(ch->inFd >= 0 && ch->outFd >= 0) return true;
+	}
+	else if(!strncmp(spec, "file:", 5)){
+
+		const char* comma = strchr(spec += 5, ',');
+		char in[256];
+
+		if(!comma || comma - spec >= (int)sizeof(in)) return false;
+		__mem_copy((UInt8*)in, (const UInt8*)spec, comma - spec);
+		in[comma - spec] = 0;
+
+		if(in[0] && (ch->inFd = open(in, O_RDONLY)) < 0) return false;
+		if(comma[1] && (ch->outFd = open(comma + 1, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+
+			if(ch->inFd >= 0) close(ch->inFd);
+			return false;
+		}
+		return true;
+	}
+
+	hostChanClose(ch);
+	return false;
+}
+
+void hostChanFlush(HostChan* ch){
+
+	UInt32 done = 0;
+	int i;
+
+	while(done < ch->outLen && ch->outFd >= 0){
+
+		i = send(ch->outFd, ch->outBuf + done, ch->outLen - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if(i < 0 && errno == ENOTSOCK) i = write(ch->outFd, ch->outBuf + done, ch->outLen - done);
+		if(i < 0 && errno == EINTR) continue;
+		if(i < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){	//reader is behind: keep the rest for next time
+
+			__mem_copy(ch->outBuf, ch->outBuf + done, ch->outLen - done);	//forward copy, fine for moving down
+			ch->outLen -= done;
+			return;
+		}
+		if(i <= 0) break;	//peer gone, output is lost
+		done += i;
+	}
+	ch->outLen = 0;
+}
+
+void hostChanClose(HostChan* ch){
+
+	hostChanFlush(ch);
+
+	if(ch->inFd >= 0) close(ch->inFd);
+	if(ch->outFd >= 0 && ch->outFd != ch->inFd) close(ch->outFd);
+	if(ch->listenFd >= 0) close(ch->listenFd);
+	ch->listenFd = ch->inFd = ch->outFd = -1;
+}
+
+int hostChanPollFd(HostChan* ch){
+
+	return ch->inFd >= 0 ? ch->inFd : ch->listenFd;
+}
+
+UInt16 hostChanRead(void* userData){
+
+	HostChan* ch = userData;
+	int i;
+
+	if(ch->outLen && !ch->written) hostChanFlush(ch);	//guest's tx fifo drained
+	ch->written = false;
+
+	if(ch->inPos < ch->inLen) return ch->inBuf[ch->inPos++];
+
+	if(ch->idle){
+
+		ch->idle--;
+		return UART_CHAR_NONE;
+	}
+	ch->idle = HOST_CHAN_IDLE_POLLS;
+
+	if(ch->listenFd >= 0 && ch->inFd < 0){	//waiting for a client
+
+		ch->inFd = ch->outFd = accept(ch->listenFd, NULL, NULL);
+		if(ch->inFd < 0) return UART_CHAR_NONE;
+	}
+	if(ch->inFd < 0) return UART_CHAR_NONE;
+
+	i = recv(ch->inFd, ch->inBuf, sizeof(ch->inBuf), MSG_DONTWAIT);
+	if(i < 0 && errno == ENOTSOCK) i = read(ch->inFd, ch->inBuf, sizeof(ch->inBuf));	//fifo in is nonblocking already, files never block
+	if(i == 0 && ch->listenFd >= 0){	//client hung up, wait for the next one
+
+		hostChanFlush(ch);
+		close(ch->inFd);
+		ch->inFd = ch->outFd = -1;
+	}
+	else if(i == 0 && ch->inFd != ch->outFd){	//input file used up, nothing left to poll for
+
+		close(ch->inFd);
+		ch->inFd = -1;
+	}
+	if(i <= 0) return UART_CHAR_NONE;
+
+	ch->idle = 0;
+	ch->inPos = 1;
+	ch->inLen = i;
+	return ch->inBuf[0];
+}
+
+void hostChanWrite(UInt16 chr, void* userData){
+
+	HostChan* ch = userData;
+
+	if(chr & 0xFF00) return;	//breaks and errors have no byte to send
+
+	if(ch->outLen == HOST_CHAN_BUF_SZ) return;	//reader stalled with the buffer full: drop, like an overrun on a real line
+
+	ch->outBuf[ch->outLen++] = chr;
+	ch->written = true;
+	if(ch->outLen == HOST_CHAN_BUF_SZ) hostChanFlush(ch);
+}
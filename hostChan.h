@@ -0,0 +1,48 @@
+#ifndef _HOST_CHAN_H_
+#define _HOST_CHAN_H_
+
+#include "types.h"
+
+/*
+	Host end of an extra UART (host builds only). Specs:
+
+		unix:path		listen on a unix stream socket, one client at a time, both directions
+		fifo:path		guest reads path.in and writes path.out (both created if missing)
+		file:in,out		guest reads file "in" once through and writes file "out" (either may be empty)
+
+	Output is buffered and goes out when the buffer fills or the guest's TX
+	FIFO drains. Neither direction blocks: output a slow reader has not
+	taken yet stays buffered for the next flush (and new bytes are dropped
+	once the buffer is full), and an idle input is only polled every
+	HOST_CHAN_IDLE_POLLS calls so it costs next to no syscalls.
+*/
+
+#define HOST_CHAN_BUF_SZ	4096
+#define HOST_CHAN_IDLE_POLLS	64
+
+typedef struct{
+
+	int listenFd;		//unix: only
+	int inFd;
+	int outFd;
+
+	UInt32 outLen;
+	UInt32 inPos;
+	UInt32 inLen;
+	UInt8 idle;		//polls to skip after finding no input
+	Boolean written;	//output seen since last read poll
+
+	UInt8 outBuf[HOST_CHAN_BUF_SZ];
+	UInt8 inBuf[HOST_CHAN_BUF_SZ];
+
+}HostChan;
+
+Boolean hostChanOpen(HostChan* ch, const char* spec);
+void hostChanClose(HostChan* ch);
+void hostChanFlush(HostChan* ch);
+int hostChanPollFd(HostChan* ch);			//fd that becomes readable when input may be there, -1 if none
+
+UInt16 hostChanRead(void* userData);			//Pxa255UartReadF
+void hostChanWrite(UInt16 chr, void* userData);		//Pxa255UartWriteF
+
+#endif
@@ -17,9 +17,35 @@
 #include "SoC.h"
 #include "SD.h"
 #include "callout_RAM.h"
+#include "spiRam.h"
 
 SD sd;
 
+#ifdef SPI_RAM	//guest RAM on two APS6404 instead of the SD card
+
+	#define SPIRAM_PIN_CS0	(1 << PINB1) // Arduino UNO's digital pin 9
+	#define SPIRAM_PIN_CS1	(1 << PINB0) // Arduino UNO's digital pin 8
+
+	static SpiRam spiRam;
+	
+	static UInt8 spiRamXfer(_UNUSED_ void* userData, UInt8 byte){
+		
+		return sdSpiByte(byte);
+	}
+	
+	static void spiRamSelect(_UNUSED_ void* userData, UInt8 chip, Boolean selected){
+		
+		UInt8 pin = chip ? SPIRAM_PIN_CS1 : SPIRAM_PIN_CS0;
+		
+		if(selected){
+			
+			PORTB |= SD_PIN_CS;	//card may be mid-stream, make it let go of MISO
+			PORTB &=~ pin;
+		}
+		else PORTB |= pin;
+	}
+#endif
+
 static int readchar(){
 	if(UCSR0A & (1<<RXC0)){
 		return UDR0;
@@ -47,7 +73,9 @@ int rootOps(void* userData, UInt32 sector, void* buf, UInt8 op){
 				*(unsigned long*)buf = SD_BLOCK_SIZE;
 			}
 			else return 0;
+			return 1;
 		
+		//the guest copies every sector through RAM before asking for the next, and RAM misses go to the card too, so a stream would be closed after each one
 		case BLK_OP_READ:
 			
 			return sdSecRead(sd, sector, buf, SD_BLOCK_SIZE);
@@ -90,6 +118,11 @@ void init(){
     // set CS, MOSI and SCLK to output
     DDRB |= (1 << SD_PIN_CS) | (1 << SD_PIN_MOSI) | (1 << SD_PIN_SCLK);
 
+#ifdef SPI_RAM
+    DDRB |= SPIRAM_PIN_CS0 | SPIRAM_PIN_CS1;
+    PORTB |= SPIRAM_PIN_CS0 | SPIRAM_PIN_CS1;
+#endif
+
     // enable pull up resistor in MISO
     DDRB |= (1 << SD_PIN_MISO);
 
@@ -97,16 +130,19 @@ void init(){
     SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR1) | (1 << SPR0);
 }
 
-Boolean coRamAccess(_UNUSED_ CalloutRam* ram, UInt32 addr, UInt8 size, Boolean write, void* bufP){
+Boolean coRamAccess(void* userData, UInt32 addr, UInt8 size, Boolean write, void* bufP){
 
 	UInt8* b = bufP;
 	
-	if(write) ramWrite(&sd, addr, b, size);
-	else ramRead(&sd, addr, b, size);
-
-	return true;
+	return write ? ramWrite(userData, addr, b, size) : ramRead(userData, addr, b, size);
 }
 
+#ifdef SPI_RAM
+	static RamCallout ramCo = {spiRamAccess, &spiRam};
+#else
+	static RamCallout ramCo = {coRamAccess, &sd};
+#endif
+
 static SoC soc;
 
 int main(){
@@ -119,24 +155,36 @@ int main(){
 
 	err_str("SD init completed!"); // For debuging only
 
-	socInit(&soc, socRamModeCallout, coRamAccess, readchar, writechar, rootOps, &sd);
+#ifdef SPI_RAM
+	spiRamInit(&spiRam, SPI_RAM_APS6404, 2, false, spiRamXfer, spiRamSelect, NULL);
+#endif
+
+	socInit(&soc, socRamModeCallout, &ramCo, readchar, writechar, rootOps, &sd);
 	
 	if(!(PIND & 0x10)){	//hack for faster boot in case we know all variables & button is pressed
+#ifdef SPI_RAM		//RAM is off the card, so one read stream covers the whole image
 		UInt32 s = 786464UL;
-		UInt32 d = 0xA0E00000;
+		UInt32 d = 0x00E00000;	//0xA0E00000 in RAM
 		UInt8* b = (UInt8*)soc.blkDevBuf;
 
 		for(UInt32 i = 0; i < 4096; i++){
-			sdSecRead(&sd, s++, b, SD_BLOCK_SIZE);
+			sdStreamRead(&sd, s++, b);
 			for(UInt16 j = 0; j < 512; j += 32, d+= 32){
 				
-				ramWrite(&sd, d, b + j, 32);
+				ramCo.accessF(ramCo.userData, d, 32, true, b + j);
 			}
 		}
+		sdStreamStop(&sd);
+#else
+		ramLoad(&sd, 0x00E00000, 786464UL, 4096);	//0xA0E00000 in RAM
+#endif
 		soc.cpu.regs[15] = 0xA0E00512UL;
 	}
 
 	socRun(&soc);
+#ifndef SPI_RAM
+	ramFlush(&sd);
+#endif
 
 	while(1); // Emulation stop for some reason
 }
@@ -1,4 +1,8 @@
 #include "SoC.h"
+#include "cowDisk.h"
+#include "spiRamSim.h"
+#include "hostChan.h"
+#include "mmioTrace.h"
 
 	
 #include <sys/time.h>
@@ -9,9 +13,15 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <sys/select.h>
 #include <signal.h>
 #include <termios.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#ifdef LCD_SUPPORT
+	#include <SDL/SDL.h>
+#endif
 
 
 #define off64_t __off64_t
@@ -67,28 +77,80 @@ unsigned char* readFile(const char* name, UInt32* lenP){
 
 static int ctlCSeen = 0;
 
+/*
+	Console I/O. Guest output collects in outBuf and goes out in one write on
+	newline, when the buffer fills, or once the UART's TX FIFO has drained
+	(a readchar poll with no writechar since the previous one). Input is read
+	by its own thread into a single-producer single-consumer ring, so polling
+	for it costs no syscall. The reader thread also pokes inWake so that an
+	idle guest sleeping in hostSleep() wakes up for it.
+*/
+
+#define OUT_BUF_SZ	4096
+#define IN_RING_SZ	256	//power of two
+
+static char outBuf[OUT_BUF_SZ];
+static UInt32 outLen = 0;
+static Boolean outWritten = false;
+
+static UInt8 inRing[IN_RING_SZ];
+static UInt32 inHead = 0;	//written by reader thread only
+static UInt32 inTail = 0;	//written by emulator thread only
+static int inWake[2] = {-1, -1};	//pipe, reader thread -> hostSleep()
+
+static void outFlush(void){
+	
+	UInt32 done = 0;
+	int i;
+	
+	while(done < outLen){
+		
+		i = write(1, outBuf + done, outLen - done);
+		if(i <= 0) break;
+		done += i;
+	}
+	outLen = 0;
+}
+
+static void* inReaderThread(_UNUSED_ void* arg){
+	
+	UInt8 buf[64];
+	UInt32 head, i;
+	int n;
+	
+	while((n = read(0, buf, sizeof(buf))) > 0){
+		
+		head = __atomic_load_n(&inHead, __ATOMIC_RELAXED);
+		for(i = 0; i < (UInt32)n; i++){
+			
+			while(head - __atomic_load_n(&inTail, __ATOMIC_ACQUIRE) == IN_RING_SZ) usleep(1000);	//guest is not keeping up
+			inRing[head++ % IN_RING_SZ] = buf[i];
+			__atomic_store_n(&inHead, head, __ATOMIC_RELEASE);
+		}
+		if(write(inWake[1], "", 1) < 0){}	//full pipe is fine, a wakeup is already pending
+	}
+	
+	return NULL;
+}
+
 static int readchar(void){
 	
-	struct timeval tv;
-	fd_set set;
-	char c;
-	int i, ret = CHAR_NONE;
+	UInt32 tail;
+	int ret = CHAR_NONE;
+	
+	if(outLen && !outWritten) outFlush();	//tx fifo drained
+	outWritten = false;
 	
 	if(ctlCSeen){
 		ctlCSeen = 0;
 		return 0x03;
 	}
 	
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	
-	FD_ZERO(&set);
-	FD_SET(0, &set);
-	
-	i = select(1, &set, NULL, NULL, &tv);
-	if(i == 1 && 1 == read(0, &c, 1)){
+	tail = inTail;
+	if(tail != __atomic_load_n(&inHead, __ATOMIC_ACQUIRE)){
 		
-		ret = c;
+		ret = inRing[tail % IN_RING_SZ];
+		__atomic_store_n(&inTail, tail + 1, __ATOMIC_RELEASE);
 	}
 
 	return ret;
@@ -96,14 +158,142 @@ static int readchar(void){
 
 static void writechar(int chr){
 
+	if(OUT_BUF_SZ - outLen < 32) outFlush();
+	
 	if(!(chr & 0xFF00)){
 		
-		printf("%c", chr);
+		outBuf[outLen++] = chr;
 	}
 	else{
-		printf("<<~~ EC_0x%x ~~>>", chr);
+		outLen += snprintf(outBuf + outLen, OUT_BUF_SZ - outLen, "<<~~ EC_0x%x ~~>>", chr);
+	}
+	outWritten = true;
+	
+	if(chr == '\n') outFlush();
+}
+
+/*
+	Idle guest: block until the guest time it wants to skip has passed on
+	the wall clock, or until there is input for one of the UARTs. Waits
+	under a millisecond (poll()'s granularity) are skipped right away.
+*/
+
+static HostChan btChan, stChan;
+static Boolean btOpen = false, stOpen = false;
+
+static UInt32 hostSleep(_UNUSED_ void* userData, UInt32 cycles){
+	
+	struct pollfd fds[3];
+	struct timespec start, now;
+	unsigned long long ns;
+	int n = 0, ms = (unsigned long long)cycles * 1000ULL / SOC_CYCLES_PER_SEC;
+	char junk[64];
+	
+	if(!ms) return cycles;
+	if(inTail != __atomic_load_n(&inHead, __ATOMIC_ACQUIRE)) return cycles;	//input waiting already, let the UART have it now
+	
+	outFlush();
+	if(btOpen) hostChanFlush(&btChan);
+	if(stOpen) hostChanFlush(&stChan);
+	
+	fds[n].fd = inWake[0];
+	fds[n++].events = POLLIN;
+	if(btOpen && (fds[n].fd = hostChanPollFd(&btChan)) >= 0) fds[n++].events = POLLIN;
+	if(stOpen && (fds[n].fd = hostChanPollFd(&stChan)) >= 0) fds[n++].events = POLLIN;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(poll(fds, n, ms) > 0 && (fds[0].revents & POLLIN)) while(read(inWake[0], junk, sizeof(junk)) == sizeof(junk));
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	ns = (now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec;
+	ns = ns * SOC_CYCLES_PER_SEC / 1000000000ULL;
+	
+	return ns < cycles ? ns : cycles;
+}
+
+/*
+	LCD output. The controller hands over only the rows that changed. "shm:path"
+	maps path (e.g. under /dev/shm) as a LcdShm and copies rows in, bumping
+	"frames" once a frame is complete, so a test can poll it with no window
+	around. "sdl" opens a window (debug builds, which define LCD_SUPPORT).
+*/
+
+#define LCD_SHM_MAGIC	0x44434C75UL	//"uLCD"
+
+typedef struct{
+	
+	UInt32 magic;
+	UInt32 width;
+	UInt32 height;
+	UInt32 frames;		//completed frames, pixels are stable right after this changes
+	UInt16 pixels[PXA255_LCD_MAX_WIDTH * PXA255_LCD_MAX_WIDTH];	//RGB565, "width" per row
+	
+}LcdShm;
+
+static LcdShm* lcdShm = NULL;
+#ifdef LCD_SUPPORT
+	static SDL_Surface* lcdSurface = NULL;
+	static UInt16 lcdFirstRow = 0xFFFF, lcdLastRow = 0;
+#endif
+
+static void lcdShmOut(_UNUSED_ void* userData, UInt16 width, UInt16 height, UInt16 row, const UInt16* pixels){
+	
+	lcdShm->width = width;
+	lcdShm->height = height;
+	if(pixels) __mem_copy((UInt8*)(lcdShm->pixels + (UInt32)row * width), (const UInt8*)pixels, width * sizeof(UInt16));
+	else __atomic_store_n(&lcdShm->frames, lcdShm->frames + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef LCD_SUPPORT
+static void lcdSdlOut(_UNUSED_ void* userData, UInt16 width, UInt16 height, UInt16 row, const UInt16* pixels){
+	
+	if(!lcdSurface || lcdSurface->w != width || lcdSurface->h != height){
+		
+		lcdSurface = SDL_SetVideoMode(width, height, 16, SDL_SWSURFACE);
+		if(!lcdSurface) return;
+	}
+	
+	if(pixels){
+		
+		if(SDL_MUSTLOCK(lcdSurface)) SDL_LockSurface(lcdSurface);
+		__mem_copy((UInt8*)lcdSurface->pixels + (UInt32)row * lcdSurface->pitch, (const UInt8*)pixels, width * sizeof(UInt16));
+		if(SDL_MUSTLOCK(lcdSurface)) SDL_UnlockSurface(lcdSurface);
+		if(row < lcdFirstRow) lcdFirstRow = row;
+		if(row > lcdLastRow) lcdLastRow = row;
+	}
+	else if(lcdFirstRow <= lcdLastRow){
+		
+		SDL_UpdateRect(lcdSurface, 0, lcdFirstRow, width, lcdLastRow - lcdFirstRow + 1);
+		lcdFirstRow = 0xFFFF;
+		lcdLastRow = 0;
+		SDL_PumpEvents();
+	}
+}
+#endif
+
+static Pxa255lcdOutF lcdOpen(const char* spec){
+	
+	int fd;
+	
+	if(!strncmp(spec, "shm:", 4)){
+		
+		fd = open(spec + 4, O_RDWR | O_CREAT, 0644);
+		if(fd < 0 || ftruncate(fd, sizeof(LcdShm))) return NULL;
+		lcdShm = mmap(NULL, sizeof(LcdShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if(lcdShm == MAP_FAILED) return NULL;
+		lcdShm->magic = LCD_SHM_MAGIC;
+		return lcdShmOut;
+	}
+#ifdef LCD_SUPPORT
+	if(!strcmp(spec, "sdl")){
+		
+		if(SDL_Init(SDL_INIT_VIDEO)) return NULL;
+		atexit(SDL_Quit);
+		return lcdSdlOut;
 	}
-	fflush(stdout);	
+#endif
+	return NULL;
 }
 
 void ctl_cHandler(_UNUSED_ int v){	//handle SIGTERM      
@@ -157,15 +347,64 @@ int rootOps(void* userData, UInt32 sector, void* buf, UInt8 op){
 }
 
 SoC soc;
+static SpiRamSim spiSim;
+static SpiRam spiRam;
+static RamCallout spiCallout = {spiRamAccess, &spiRam};
+
+static void termHandler(_UNUSED_ int v){	//SIGTERM: leave socRun() so overlays get closed and MMIO stats printed
+	
+	soc.go = false;
+}
 
 int main(int argc, char** argv){
 	
 	struct termios cfg, old;
 	FILE* root = NULL;
-	int gdbPort = 0;
+	const char* overlay = NULL;
+	const char* btSpec = NULL;
+	const char* stSpec = NULL;
+	const char* lcdSpec = NULL;
+	const char* mmioPath = NULL;
+	MmioTrace* mmio = NULL;
+	Boolean mmioStats = false;
+	Boolean branchStats = false;
+	Pxa255lcdOutF lcdOutF = NULL;
+	Boolean spiRamMode = false;
+	UInt32 uartRate = 0;
+	CowDisk cow;
+	int gdbPort = 0, c;
+	
+	while((c = getopt(argc, argv, "o:su:B:S:l:mM:b")) != -1){
+		
+		if(c == 'o') overlay = optarg;
+		else if(c == 'B') btSpec = optarg;
+		else if(c == 'S') stSpec = optarg;
+		else if(c == 'l') lcdSpec = optarg;
+		else if(c == 'm') mmioStats = true;
+		else if(c == 'M') mmioPath = optarg;
+		else if(c == 'b') branchStats = true;
+		else if(c == 's') spiRamMode = true;
+		else if(c == 'u') uartRate = strtoul(optarg, NULL, 0);
+		else argc = 0;
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
 	
 	if(argc != 3 && argc != 2){
-		fprintf(stderr,"usage: %s path_to_disk [gdbPort]\n", argv[0]);
+		fprintf(stderr,"usage: %s [-o overlay] [-s] [-u ips] [-B chan] [-S chan] [-l lcd] [-m] [-M trace] [-b] path_to_disk [gdbPort]\n", argv[0]);
+		fprintf(stderr,"\t-o overlay\topen path_to_disk read-only and keep all writes in the overlay file (created if missing)\n");
+		fprintf(stderr,"\t-s\t\trun guest RAM through the SPI RAM driver on simulated APS6404 chips\n");
+		fprintf(stderr,"\t-u ips\t\tpace the console UART at its programmed baud rate, taking ips guest instructions as one second (default: host speed)\n");
+		fprintf(stderr,"\t-B chan\t\tconnect BTUART to a host channel: unix:path, fifo:path (uses path.in and path.out) or file:in,out\n");
+		fprintf(stderr,"\t-S chan\t\tsame for STUART\n");
+		fprintf(stderr,"\t-l lcd\t\tshow the LCD: shm:path (headless, frames go to a mapped file)"
+	#ifdef LCD_SUPPORT
+			" or sdl"
+	#endif
+			"\n");
+		fprintf(stderr,"\t-m\t\tcount device register accesses, print them on exit\n");
+		fprintf(stderr,"\t-M trace\tsame, and write every device access to the trace file (see mmioTrace.h)\n");
+		fprintf(stderr,"\t-b\t\tprint how often instruction fetch found its new page in the return address stack and branch target cache on exit\n");
 		return -1;	
 	}
 	
@@ -190,19 +429,98 @@ int main(int argc, char** argv){
 		if(ret) perror("cannot set term attrs");
 	}
 	
-	root = fopen64(argv[1], "r+b");
-	if(!root){
-		fprintf(stderr,"Failed to open root device\n");
-		exit(-1);
+	if(overlay){
+		
+		if(!cowDiskOpen(&cow, argv[1], overlay)) exit(-1);
+	}
+	else{
+		
+		root = fopen64(argv[1], "r+b");
+		if(!root){
+			fprintf(stderr,"Failed to open root device\n");
+			exit(-1);
+		}
 	}
 	
 	if(argc >= 3) gdbPort = atoi(argv[2]);
 	
-	socInit(&soc, socRamModeAlloc, NULL, readchar, writechar, rootOps, root);
+	{
+		pthread_t th;
+		
+		if(pipe(inWake) || fcntl(inWake[0], F_SETFL, O_NONBLOCK) || fcntl(inWake[1], F_SETFL, O_NONBLOCK)) perror("cannot create wakeup pipe");
+		if(pthread_create(&th, NULL, inReaderThread, NULL)) perror("cannot start input thread");
+		else pthread_detach(th);
+	}
+	
+	if(spiRamMode){
+		
+		if(!spiRamSimInit(&spiSim, SPI_RAM_APS6404, 2)){
+			fprintf(stderr,"Failed to allocate SPI RAM\n");
+			exit(-1);
+		}
+		spiRamInit(&spiRam, SPI_RAM_APS6404, 2, true, spiRamSimXfer, spiRamSimSelect, &spiSim);
+	}
+	
+	socInit(&soc, spiRamMode ? socRamModeCallout : socRamModeAlloc, spiRamMode ? &spiCallout : NULL, readchar, writechar, overlay ? cowDiskOps : rootOps, overlay ? (void*)&cow : (void*)root);
+	pxa255uartSetRate(&soc.ffuart, uartRate);
+	if(btSpec){
+		
+		if(!hostChanOpen(&btChan, btSpec)){
+			fprintf(stderr,"Failed to open BTUART channel '%s'\n", btSpec);
+			exit(-1);
+		}
+		pxa255uartSetFuncs(&soc.btuart, hostChanRead, hostChanWrite, &btChan);
+		btOpen = true;
+	}
+	if(stSpec){
+		
+		if(!hostChanOpen(&stChan, stSpec)){
+			fprintf(stderr,"Failed to open STUART channel '%s'\n", stSpec);
+			exit(-1);
+		}
+		pxa255uartSetFuncs(&soc.stuart, hostChanRead, hostChanWrite, &stChan);
+		stOpen = true;
+	}
+	if(lcdSpec){
+		
+		if(!(lcdOutF = lcdOpen(lcdSpec))){
+			fprintf(stderr,"Failed to open LCD output '%s'\n", lcdSpec);
+			exit(-1);
+		}
+		pxa255lcdSetOutF(&soc.lcd, lcdOutF, NULL);
+	}
+	if(mmioStats || mmioPath){
+		
+		mmio = malloc(sizeof(MmioTrace));
+		if(!mmio || !mmioTraceOpen(mmio, &soc.mem, &soc.cycles, mmioPath)){
+			fprintf(stderr,"Failed to start MMIO tracing\n");
+			exit(-1);
+		}
+	}
+	socSetSleepF(&soc, hostSleep, NULL);
 	signal(SIGINT, &ctl_cHandler);
+	signal(SIGTERM, &termHandler);
 	socRun(&soc, gdbPort);
+	outFlush();
+	if(btOpen) hostChanClose(&btChan);
+	if(stOpen) hostChanClose(&stChan);
+	if(mmio){
+		
+		mmioTraceClose(mmio, &soc.mem);
+		mmioTraceReport(mmio, stderr);
+		free(mmio);
+	}
+	if(branchStats){
+		
+		unsigned long long all = (unsigned long long)soc.cpu.rasHits + soc.cpu.btcHits + soc.cpu.btcMisses;
+		
+		fprintf(stderr, "fetch page changes: %llu, RAS hits %lu, BTC hits %lu, BTC misses %lu (%.1f%% hit)\n", all,
+			(unsigned long)soc.cpu.rasHits, (unsigned long)soc.cpu.btcHits, (unsigned long)soc.cpu.btcMisses,
+			all ? 100.0 * (all - soc.cpu.btcMisses) / all : 0.0);
+	}
 	
-	fclose(root);
+	if(overlay) cowDiskClose(&cow);
+	else fclose(root);
 	tcsetattr(0, TCSANOW, &old);
 	
 	return 0;
@@ -221,13 +539,20 @@ void emu_free(void* ptr){
 	free(ptr);
 }
 
-UInt32 rtcCurTime(void){
+UInt32 rtcCurTime(void){	//wall time read once, then moved along by the monotonic clock so host clock steps do not reach the guest
 	
-	struct timeval tv;
+	static UInt32 baseSec = 0;
+	static struct timespec base;
+	struct timespec now;
 	
-	gettimeofday(&tv, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if(!baseSec){
+		
+		baseSec = time(NULL);
+		base = now;
+	}
 	
-	return tv.tv_sec;	
+	return baseSec + (now.tv_sec - base.tv_sec);
 }
 
 void err_str(const char* str){
@@ -142,7 +142,7 @@ UInt64 u64_xtnd32(UInt64 v){
 
 Boolean u64_isZero(UInt64 a){
 	
-	return a.lo == a.hi == 0;
+	return !a.lo && !a.hi;
 }
 
 UInt64 u64_inc(UInt64 v){
@@ -7,9 +7,35 @@ void memInit(ArmMem* mem){
 	for(UInt8 i = 0; i < MAX_MEM_REGIONS; i++){
 		mem->regions[i].sz = 0;
 	}
+#ifndef EMBEDDED
+	mem->traceF = NULL;
+	mem->codeF = NULL;
+	for(UInt32 i = 0; i < sizeof(mem->code) / sizeof(*mem->code); i++) mem->code[i] = 0;
+#endif
 }
 
-Boolean memRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void* uD){
+#ifndef EMBEDDED
+
+	static _INLINE_ Boolean memPrvIsCode(ArmMem* mem, UInt32 addr){
+		
+		return (mem->code[addr >> (MEM_CODE_PAGE_SHIFT + 5)] >> ((addr >> MEM_CODE_PAGE_SHIFT) & 31)) & 1;
+	}
+	
+	static void memPrvCodeWritten(ArmMem* mem, UInt32 addr, UInt32 size){	//bursts are under a page so they touch two at most
+		
+		UInt32 ends[2] = {addr, addr + size - 1};
+		
+		for(UInt8 i = 0; i < 2; i++){
+			
+			if(!memPrvIsCode(mem, ends[i])) continue;
+			mem->code[ends[i] >> (MEM_CODE_PAGE_SHIFT + 5)] &=~ (1UL << ((ends[i] >> MEM_CODE_PAGE_SHIFT) & 31));
+			mem->codeF(mem->codeD, ends[i] &~ ((1UL << MEM_CODE_PAGE_SHIFT) - 1));
+		}
+	}
+
+#endif
+
+static Boolean memPrvRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void* uD, Boolean burst){
 	
 	//check for intersection with another region
 	
@@ -32,6 +58,10 @@ Boolean memRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void*
 			mem->regions[i].sz = sz;
 			mem->regions[i].aF = aF;
 			mem->regions[i].uD = uD;
+			mem->regions[i].burst = burst;
+		#ifndef EMBEDDED
+			mem->regions[i].ptrF = NULL;
+		#endif
 		
 			return true;
 		}
@@ -43,6 +73,16 @@ Boolean memRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void*
 	return false;	
 }
 
+Boolean memRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void* uD){
+	
+	return memPrvRegionAdd(mem, pa, sz, aF, uD, false);
+}
+
+Boolean memRegionAddBurst(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, void* uD){
+	
+	return memPrvRegionAdd(mem, pa, sz, aF, uD, true);
+}
+
 Boolean memRegionDel(ArmMem* mem, UInt32 pa, UInt32 sz){
 	
 	for(UInt8 i = 0; i < MAX_MEM_REGIONS; i++){
@@ -58,13 +98,76 @@ Boolean memRegionDel(ArmMem* mem, UInt32 pa, UInt32 sz){
 
 Boolean memAccess(ArmMem* mem, UInt32 addr, UInt8 size, Boolean write, void* buf){
 	
+#ifndef EMBEDDED
+	if((write & 0x7F) && (memPrvIsCode(mem, addr) || (size > 4 && memPrvIsCode(mem, addr + size - 1)))) memPrvCodeWritten(mem, addr, size);
+#endif
+
 	for(UInt8 i = 0; i < MAX_MEM_REGIONS; i++){
-		if(mem->regions[i].pa <= addr && mem->regions[i].pa + mem->regions[i].sz > addr){
+		ArmMemRegion* r = mem->regions + i;
 		
-			return mem->regions[i].aF(mem->regions[i].uD, addr, size, write & 0x7F, buf);
+		if(r->pa <= addr && r->pa + r->sz > addr){
+			
+			//bursts only go to memory and may not leave the region. callers fall back to words, so devices never see half a burst
+			if(size > 4 && (!r->burst || addr - r->pa + size > r->sz)) return false;
+		#ifndef EMBEDDED
+			if(mem->traceF && !r->burst){
+				
+				Boolean ok = r->aF(r->uD, addr, size, write & 0x7F, buf);
+				
+				mem->traceF(mem->traceD, r->pa, addr, size, write & 0x7F, buf, ok);
+				return ok;
+			}
+		#endif
+			
+			return r->aF(r->uD, addr, size, write & 0x7F, buf);
 		}
 	}
 	
 	return false; // If failed
 }
 
+#ifndef EMBEDDED
+
+	Boolean memRegionAddDirect(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF aF, ArmMemPtrF pF, void* uD){
+		
+		UInt8 i;
+		
+		if(!memPrvRegionAdd(mem, pa, sz, aF, uD, true)) return false;
+		for(i = 0; mem->regions[i].pa != pa || mem->regions[i].sz != sz; i++);
+		mem->regions[i].ptrF = pF;
+		
+		return true;
+	}
+	
+	void* memGetPtr(ArmMem* mem, UInt32 addr, UInt32 size, Boolean write){
+		
+		if(write && (memPrvIsCode(mem, addr) || memPrvIsCode(mem, addr + size - 1))) memPrvCodeWritten(mem, addr, size);
+		
+		for(UInt8 i = 0; i < MAX_MEM_REGIONS; i++){
+			ArmMemRegion* r = mem->regions + i;
+			
+			if(r->pa <= addr && r->pa + r->sz > addr) return r->ptrF ? r->ptrF(r->uD, addr, size, write) : NULL;
+		}
+		
+		return NULL;
+	}
+
+	void memSetTraceF(ArmMem* mem, ArmMemTraceF traceF, void* userData){
+		
+		mem->traceF = traceF;
+		mem->traceD = userData;
+	}
+	
+	void memSetCodeWriteF(ArmMem* mem, ArmMemCodeWriteF codeF, void* userData){
+		
+		mem->codeF = codeF;
+		mem->codeD = userData;
+	}
+	
+	void memMarkCode(ArmMem* mem, UInt32 addr){
+		
+		if(mem->codeF) mem->code[addr >> (MEM_CODE_PAGE_SHIFT + 5)] |= 1UL << ((addr >> MEM_CODE_PAGE_SHIFT) & 31);
+	}
+
+#endif
+
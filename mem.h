@@ -3,13 +3,22 @@
 
 #include "types.h"
 
-#define MAX_MEM_REGIONS		4
+#ifdef EMBEDDED
+	#define MAX_MEM_REGIONS		5	//ROM, RAM, IC, FFUART, TIMR
+#else
+	#define MAX_MEM_REGIONS		16
+#endif
 
 #define errPhysMemNoSuchRegion	(errPhysMem + 1)		//this physical address is not claimed by any region
 #define errPhysMemInvalidAdr	(errPhysMem + 2)		//address is IN a region but access to it is not allowed (it doesn't exist really)
 #define errPhysMemInvalidSize	(errPhysMem + 3)		//access that is not 1, 2 or 4-byte big
 
 typedef Boolean (*ArmMemAccessF)(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf);
+typedef void* (*ArmMemPtrF)(void* userData, UInt32 pa, UInt32 size, Boolean write);	//host address of these bytes, NULL if they cannot be touched directly
+typedef void (*ArmMemTraceF)(void* userData, UInt32 regionPa, UInt32 pa, UInt8 size, Boolean write, const void* buf, Boolean ok);	//sees every device (non-burst region) access once it is done
+typedef void (*ArmMemCodeWriteF)(void* userData, UInt32 pa);	//a page marked as code was written, its mark is gone now
+
+#define MEM_CODE_PAGE_SHIFT	12	//code tracking granularity: 4K
 
 typedef struct{
 
@@ -17,12 +26,24 @@ typedef struct{
 	UInt32 sz;
 	ArmMemAccessF aF;
 	void* uD;
+	Boolean burst;		//aF takes any multiple of 4 bytes in one call. others only see 1/2/4 byte accesses
+#ifndef EMBEDDED
+	ArmMemPtrF ptrF;	//NULL unless the region is plain host memory
+#endif
 
 }ArmMemRegion;
 
 typedef struct{
 
 	ArmMemRegion regions[MAX_MEM_REGIONS];
+#ifndef EMBEDDED
+	ArmMemTraceF traceF;
+	void* traceD;
+	
+	ArmMemCodeWriteF codeF;
+	void* codeD;
+	UInt32 code[1UL << (32 - MEM_CODE_PAGE_SHIFT - 5)];	//a bit per page something cached code from
+#endif
 
 }ArmMem;
 
@@ -31,8 +52,16 @@ void memInit(ArmMem* mem);
 void memDeinit(ArmMem* mem);
 
 Boolean memRegionAdd(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF af, void* uD);
+Boolean memRegionAddBurst(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF af, void* uD);	//for memory-like regions
 Boolean memRegionDel(ArmMem* mem, UInt32 pa, UInt32 sz);
 
 Boolean memAccess(ArmMem* mem, UInt32 addr, UInt8 size, Boolean write, void* buf);
+#ifndef EMBEDDED
+	Boolean memRegionAddDirect(ArmMem* mem, UInt32 pa, UInt32 sz, ArmMemAccessF af, ArmMemPtrF pf, void* uD);	//burst region that can also hand out pointers
+	void* memGetPtr(ArmMem* mem, UInt32 addr, UInt32 size, Boolean write);	//NULL if not all in one direct region, use memAccess() then
+	void memSetTraceF(ArmMem* mem, ArmMemTraceF traceF, void* userData);	//NULL to stop
+	void memSetCodeWriteF(ArmMem* mem, ArmMemCodeWriteF codeF, void* userData);
+	void memMarkCode(ArmMem* mem, UInt32 addr);	//codeF gets called on the next write to this page (by anyone, cpu or DMA)
+#endif
 
 #endif
@@ -0,0 +1,144 @@
+#include "mmioTrace.h"
+#include "rt.h"
+#include <stdlib.h>
+
+
+static void mmioTracePrvFlush(MmioTrace* t){
+
+	if(t->numRecs && fwrite(t->recs, sizeof(MmioTraceRec), t->numRecs, t->f) != t->numRecs) perror("MMIO trace write");
+	t->numRecs = 0;
+}
+
+static MmioTraceReg* mmioTracePrvFind(MmioTrace* t, UInt32 regionPa, UInt32 pa){	//empty slots have regionPa == 0, no device lives there
+
+	UInt32 i = (pa ^ (pa >> 12)) >> 2;
+	MmioTraceReg* r;
+
+	while(1){
+
+		r = &t->regs[i++ & (MMIO_TRACE_REGS - 1)];
+		if(r->regionPa && r->pa == pa) return r;
+		if(r->regionPa) continue;
+
+		if(t->numRegs == MMIO_TRACE_REGS / 2) return NULL;	//half full at most, keeps probes short and always ending
+		r->pa = pa;
+		r->regionPa = regionPa;
+		t->numRegs++;
+		return r;
+	}
+}
+
+static void mmioTracePrvAccess(void* userData, UInt32 regionPa, UInt32 pa, UInt8 size, Boolean write, const void* buf, Boolean ok){
+
+	MmioTrace* t = userData;
+	MmioTraceReg* r = mmioTracePrvFind(t, regionPa, pa);
+	MmioTraceRec* rec;
+	UInt32 val = 0;
+
+	if(r) r->count[write ? 1 : 0][size == 4 ? 2 : size - 1]++;
+	else t->other++;
+
+	if(!t->f) return;
+
+	if(ok){
+		if(size == 1) val = *(const UInt8*)buf;
+		else if(size == 2) val = *(const UInt16*)buf;
+		else val = *(const UInt32*)buf;
+	}
+
+	rec = &t->recs[t->numRecs++];
+	rec->cycles = *t->cycles;
+	rec->pa = pa;
+	rec->val = val;
+	rec->size = size;
+	rec->flags = (write ? MMIO_TRACE_WRITE : 0) | (ok ? 0 : MMIO_TRACE_FAIL);
+	rec->rfu = 0;
+
+	if(t->numRecs == MMIO_TRACE_BUF_RECS) mmioTracePrvFlush(t);
+}
+
+Boolean mmioTraceOpen(MmioTrace* t, ArmMem* mem, const UInt32* cycles, const char* tracePath){
+
+	MmioTraceHdr hdr = {MMIO_TRACE_MAGIC, MMIO_TRACE_VERSION, sizeof(MmioTraceRec)};
+
+	t->cycles = cycles;
+	t->f = NULL;
+	t->numRecs = 0;
+	t->numRegs = 0;
+	t->other = 0;
+	for(UInt32 i = 0; i < MMIO_TRACE_REGS; i++) __mem_zero((UInt8*)&t->regs[i], sizeof(MmioTraceReg));
+
+	if(tracePath){
+
+		t->f = fopen(tracePath, "wb");
+		if(!t->f) return false;
+		if(fwrite(&hdr, sizeof(hdr), 1, t->f) != 1){
+
+			fclose(t->f);
+			return false;
+		}
+	}
+
+	memSetTraceF(mem, mmioTracePrvAccess, t);
+	return true;
+}
+
+void mmioTraceClose(MmioTrace* t, ArmMem* mem){
+
+	memSetTraceF(mem, NULL, NULL);
+	if(!t->f) return;
+
+	mmioTracePrvFlush(t);
+	fclose(t->f);
+	t->f = NULL;
+}
+
+static UInt32 mmioTracePrvTotal(const MmioTraceReg* r){
+
+	return r->count[0][0] + r->count[0][1] + r->count[0][2] + r->count[1][0] + r->count[1][1] + r->count[1][2];
+}
+
+static int mmioTracePrvCmp(const void* a, const void* b){	//by region, then busiest register first
+
+	const MmioTraceReg* ra = *(const MmioTraceReg* const*)a;
+	const MmioTraceReg* rb = *(const MmioTraceReg* const*)b;
+	UInt32 ta = mmioTracePrvTotal(ra), tb = mmioTracePrvTotal(rb);
+
+	if(ra->regionPa != rb->regionPa) return ra->regionPa < rb->regionPa ? -1 : 1;
+	if(ta != tb) return ta > tb ? -1 : 1;
+	return ra->pa < rb->pa ? -1 : (ra->pa > rb->pa);
+}
+
+void mmioTraceReport(MmioTrace* t, FILE* f){
+
+	MmioTraceReg* sorted[MMIO_TRACE_REGS];
+	unsigned long long regionR, regionW;
+	UInt32 n = 0, i, j, k;
+
+	for(i = 0; i < MMIO_TRACE_REGS; i++) if(t->regs[i].regionPa) sorted[n++] = &t->regs[i];
+	qsort(sorted, n, sizeof(*sorted), mmioTracePrvCmp);
+
+	fprintf(f, "MMIO accesses (reads by size 1/2/4, writes by size 1/2/4):\n");
+	for(i = 0; i < n; i = j){
+
+		regionR = regionW = 0;
+		for(j = i; j < n && sorted[j]->regionPa == sorted[i]->regionPa; j++){
+
+			for(k = 0; k < 3; k++){
+				regionR += sorted[j]->count[0][k];
+				regionW += sorted[j]->count[1][k];
+			}
+		}
+		fprintf(f, "region 0x%08lX: %llu reads, %llu writes\n", (unsigned long)sorted[i]->regionPa, regionR, regionW);
+
+		for(k = i; k < j; k++){
+
+			MmioTraceReg* r = sorted[k];
+
+			fprintf(f, "\t0x%08lX  R %lu/%lu/%lu  W %lu/%lu/%lu\n", (unsigned long)r->pa,
+				(unsigned long)r->count[0][0], (unsigned long)r->count[0][1], (unsigned long)r->count[0][2],
+				(unsigned long)r->count[1][0], (unsigned long)r->count[1][1], (unsigned long)r->count[1][2]);
+		}
+	}
+	if(t->other) fprintf(f, "%lu more accesses to registers past the first %u\n", (unsigned long)t->other, MMIO_TRACE_REGS / 2);
+}
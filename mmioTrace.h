@@ -0,0 +1,80 @@
+#ifndef _MMIO_TRACE_H_
+#define _MMIO_TRACE_H_
+
+#include "types.h"
+#include "mem.h"
+#include <stdio.h>
+
+/*
+	Device register access statistics and trace (host builds only).
+
+	Hooks ArmMem's dispatch (memSetTraceF()) so it sees every access that
+	goes to a device rather than to memory. Counts are kept per register
+	(address) by direction and size and printed per region and per register
+	by mmioTraceReport(). With a trace file every access is also written out
+	as a MmioTraceRec, through a buffer, after a MmioTraceHdr:
+
+		cycles		SoC's cycle counter (instructions run plus idle time skipped)
+		pa		register address
+		val		value read or written, 0 for a failed access
+		size		1, 2 or 4
+		flags		MMIO_TRACE_WRITE, MMIO_TRACE_FAIL
+*/
+
+#define MMIO_TRACE_MAGIC	0x4F494D4DUL	//"MMIO"
+#define MMIO_TRACE_VERSION	1
+
+#define MMIO_TRACE_WRITE	0x01
+#define MMIO_TRACE_FAIL		0x02
+
+#define MMIO_TRACE_REGS		4096	//table size, power of two. filled halfway at most, later registers only count as "other"
+#define MMIO_TRACE_BUF_RECS	4096
+
+typedef struct{
+
+	UInt32 magic;
+	UInt16 version;
+	UInt16 recSz;
+
+}MmioTraceHdr;
+
+typedef struct{
+
+	UInt32 cycles;
+	UInt32 pa;
+	UInt32 val;
+	UInt8 size;
+	UInt8 flags;
+	UInt16 rfu;
+
+}MmioTraceRec;
+
+typedef struct{
+
+	UInt32 pa;
+	UInt32 regionPa;
+	UInt32 count[2][3];	//[write][size 1, 2, 4]
+
+}MmioTraceReg;
+
+typedef struct{
+
+	const UInt32* cycles;
+
+	FILE* f;		//NULL if not tracing, only counting
+	UInt32 numRecs;
+
+	UInt32 numRegs;
+	UInt32 other;		//accesses that found the table full
+
+	MmioTraceReg regs[MMIO_TRACE_REGS];
+	MmioTraceRec recs[MMIO_TRACE_BUF_RECS];
+
+}MmioTrace;
+
+Boolean mmioTraceOpen(MmioTrace* t, ArmMem* mem, const UInt32* cycles, const char* tracePath);	//tracePath may be NULL for counts only
+void mmioTraceClose(MmioTrace* t, ArmMem* mem);
+void mmioTraceReport(MmioTrace* t, FILE* f);
+
+#endif
+
@@ -0,0 +1,317 @@
+#include "pxa255_DMA.h"
+#include "mem.h"
+
+
+#define DCSR_RUN		0x80000000UL
+#define DCSR_NODESCFETCH	0x40000000UL
+#define DCSR_STOPIRQEN		0x20000000UL
+#define DCSR_REQPEND		0x00000100UL
+#define DCSR_STOPSTATE		0x00000008UL
+#define DCSR_ENDINTR		0x00000004UL
+#define DCSR_STARTINTR		0x00000002UL
+#define DCSR_BUSERRINTR		0x00000001UL
+
+#define DCSR_WRITABLE		(DCSR_RUN | DCSR_NODESCFETCH | DCSR_STOPIRQEN)
+#define DCSR_W1C		(DCSR_ENDINTR | DCSR_STARTINTR | DCSR_BUSERRINTR)
+
+#define DCMD_INCSRCADDR		0x80000000UL
+#define DCMD_INCTRGADDR		0x40000000UL
+#define DCMD_FLOWSRC		0x20000000UL
+#define DCMD_FLOWTRG		0x10000000UL
+#define DCMD_STARTIRQEN		0x00400000UL
+#define DCMD_ENDIRQEN		0x00200000UL
+#define DCMD_SIZE_SHIFT		16
+#define DCMD_WIDTH_SHIFT	14
+#define DCMD_LEN_MASK		0x00001FFFUL
+
+#define DDADR_STOP		0x00000001UL
+
+#define DRCMR_MAPVLD		0x80
+#define DRCMR_CHLNUM		0x0F
+
+#define DINT_OFST		0x00F0UL
+#define DRCMR_OFST		0x0100UL
+#define DESC_OFST		0x0200UL
+
+
+static UInt32 pxa255dmaPrvDint(Pxa255dma* dma){
+
+	UInt32 r = 0, s;
+	UInt8 i;
+
+	for(i = 0; i < PXA255_DMA_CHANNELS; i++){
+
+		s = dma->channels[i].DCSR;
+		if((s & DCSR_W1C) || ((s & DCSR_STOPSTATE) && (s & DCSR_STOPIRQEN))) r |= 1UL << i;
+	}
+
+	return r;
+}
+
+static void pxa255dmaPrvRecalcInt(Pxa255dma* dma){
+
+	pxa255icInt(dma->ic, PXA255_I_DMA, pxa255dmaPrvDint(dma) != 0);
+}
+
+static void pxa255dmaPrvStop(Pxa255dma* dma, UInt8 ch){
+
+	dma->channels[ch].DCSR = (dma->channels[ch].DCSR &~ DCSR_RUN) | DCSR_STOPSTATE;
+	dma->running &=~ (1U << ch);
+}
+
+static Boolean pxa255dmaPrvAccess(Pxa255dma* dma, UInt32 pa, UInt8* buf, UInt32 len, Boolean write, UInt8 fixedWidth){	//fixedWidth: peripheral side, same address every time
+
+	UInt32 i;
+
+	if(fixedWidth){
+
+		for(i = 0; i < len; i += fixedWidth) if(!memAccess(dma->mem, pa, fixedWidth, write, buf + i)) return false;
+		return true;
+	}
+
+	if(!((pa | len) & 3) && memAccess(dma->mem, pa, len, write, buf)) return true;	//whole chunk at once
+
+	for(i = 0; i < len; ){	//region takes no bursts (or odd alignment), go by words where we can
+
+		if(!((pa + i) & 3) && len - i >= 4){
+
+			if(!memAccess(dma->mem, pa + i, 4, write, buf + i)) return false;
+			i += 4;
+		}
+		else{
+
+			if(!memAccess(dma->mem, pa + i, 1, write, buf + i)) return false;
+			i++;
+		}
+	}
+
+	return true;
+}
+
+static Boolean pxa255dmaPrvMove(Pxa255dma* dma, Pxa255dmaChannel* c, UInt32 len){
+
+	UInt32 buf[PXA255_DMA_CHUNK / sizeof(UInt32)];
+	UInt8 width = (c->DCMD >> DCMD_WIDTH_SHIFT) & 3, n;
+
+	width = width == 3 ? 4 : (width ? width : 1);
+
+	while(len){
+
+		n = len > PXA255_DMA_CHUNK ? PXA255_DMA_CHUNK : len;
+
+		if(!pxa255dmaPrvAccess(dma, c->DSADR, (UInt8*)buf, n, false, (c->DCMD & DCMD_INCSRCADDR) ? 0 : width)) return false;
+		if(!pxa255dmaPrvAccess(dma, c->DTADR, (UInt8*)buf, n, true, (c->DCMD & DCMD_INCTRGADDR) ? 0 : width)) return false;
+
+		if(c->DCMD & DCMD_INCSRCADDR) c->DSADR += n;
+		if(c->DCMD & DCMD_INCTRGADDR) c->DTADR += n;
+		c->DCMD -= n;
+		len -= n;
+	}
+
+	return true;
+}
+
+static Boolean pxa255dmaPrvFetchDesc(Pxa255dma* dma, UInt8 ch){	//false if the channel stopped instead
+
+	Pxa255dmaChannel* c = &dma->channels[ch];
+	UInt32 desc[4];
+
+	if(c->DDADR & DDADR_STOP){
+
+		pxa255dmaPrvStop(dma, ch);
+		return false;
+	}
+
+	if(!pxa255dmaPrvAccess(dma, c->DDADR &~ 0x0FUL, (UInt8*)desc, sizeof(desc), false, 0)){
+
+		c->DCSR |= DCSR_BUSERRINTR;
+		pxa255dmaPrvStop(dma, ch);
+		return false;
+	}
+
+	c->DDADR = desc[0];
+	c->DSADR = desc[1];
+	c->DTADR = desc[2];
+	c->DCMD = desc[3];
+	if(c->DCMD & DCMD_STARTIRQEN) c->DCSR |= DCSR_STARTINTR;
+
+	return true;
+}
+
+static Boolean pxa255dmaPrvChannelStep(Pxa255dma* dma, UInt8 ch){	//true if any data moved
+
+	Pxa255dmaChannel* c = &dma->channels[ch];
+	UInt32 budget = PXA255_DMA_STEP_BYTES, len, n;
+	UInt8 req;
+
+	while(budget){
+
+		len = c->DCMD & DCMD_LEN_MASK;
+
+		if(!len){	//descriptor done
+
+			if(c->DCMD & DCMD_ENDIRQEN) c->DCSR |= DCSR_ENDINTR;
+
+			if(c->DCSR & DCSR_NODESCFETCH){
+
+				pxa255dmaPrvStop(dma, ch);
+				break;
+			}
+			if(!pxa255dmaPrvFetchDesc(dma, ch)) break;
+			budget = budget > 16 ? budget - 16 : 0;	//so a loop of empty descriptors cannot hang us
+			continue;
+		}
+
+		if(c->DCMD & (DCMD_FLOWSRC | DCMD_FLOWTRG)){	//one burst per peripheral request
+
+			req = dma->chanReq[ch];
+			if(req == PXA255_DMA_REQS || !dma->reqF[req] || !dma->reqF[req](dma->reqD[req])) break;
+
+			n = 4UL << ((c->DCMD >> DCMD_SIZE_SHIFT) & 3);	//SIZE: 1 = 8, 2 = 16, 3 = 32 bytes
+		}
+		else n = len;
+
+		if(n > len) n = len;
+		if(n > budget) n = budget;
+
+		if(!pxa255dmaPrvMove(dma, c, n)){
+
+			c->DCSR |= DCSR_BUSERRINTR;
+			pxa255dmaPrvStop(dma, ch);
+			break;
+		}
+		budget -= n;
+	}
+
+	return budget != PXA255_DMA_STEP_BYTES;
+}
+
+static void pxa255dmaPrvRecalcChanReq(Pxa255dma* dma){
+
+	UInt8 i;
+
+	for(i = 0; i < PXA255_DMA_CHANNELS; i++) dma->chanReq[i] = PXA255_DMA_REQS;
+	for(i = 0; i < PXA255_DMA_REQS; i++) if(dma->DRCMR[i] & DRCMR_MAPVLD) dma->chanReq[dma->DRCMR[i] & DRCMR_CHLNUM] = i;
+}
+
+static void pxa255dmaPrvDcsrWrite(Pxa255dma* dma, UInt8 ch, UInt32 val){
+
+	Pxa255dmaChannel* c = &dma->channels[ch];
+	Boolean wasRunning = (c->DCSR & DCSR_RUN) != 0;
+
+	c->DCSR &=~ (val & DCSR_W1C);
+	c->DCSR = (c->DCSR &~ DCSR_WRITABLE) | (val & DCSR_WRITABLE);
+
+	if(!(val & DCSR_RUN)) pxa255dmaPrvStop(dma, ch);
+	else if(!wasRunning){
+
+		c->DCSR &=~ DCSR_STOPSTATE;
+		dma->running |= 1U << ch;
+		if(!(c->DCSR & DCSR_NODESCFETCH)) pxa255dmaPrvFetchDesc(dma, ch);
+	}
+}
+
+static Boolean pxa255dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255dma* dma = userData;
+	UInt32 val = 0;
+	Pxa255dmaChannel* c;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+	//	err_str(write ? "write" : "read");
+	//	err_str(" of ");
+	//	err_dec(size);
+	//	err_str(" bytes to 0x");
+	//	err_hex(pa);
+	//	err_str("\r\n");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa -= PXA255_DMA_BASE;
+	if(write) val = *(UInt32*)buf;
+
+	if(pa < PXA255_DMA_CHANNELS * 4){			//DCSR
+
+		if(write) pxa255dmaPrvDcsrWrite(dma, pa >> 2, val);
+		else val = dma->channels[pa >> 2].DCSR;
+	}
+	else if(pa == DINT_OFST){
+
+		if(!write) val = pxa255dmaPrvDint(dma);
+	}
+	else if(pa >= DRCMR_OFST && pa < DRCMR_OFST + PXA255_DMA_REQS * 4){
+
+		pa = (pa - DRCMR_OFST) >> 2;
+		if(write){
+			dma->DRCMR[pa] = val & (DRCMR_MAPVLD | DRCMR_CHLNUM);
+			pxa255dmaPrvRecalcChanReq(dma);
+		}
+		else val = dma->DRCMR[pa];
+	}
+	else if(pa >= DESC_OFST && pa < DESC_OFST + PXA255_DMA_CHANNELS * 16){
+
+		c = &dma->channels[(pa - DESC_OFST) >> 4];
+		switch((pa >> 2) & 3){
+
+			case 0:
+				if(write) c->DDADR = val;
+				else val = c->DDADR;
+				break;
+
+			case 1:
+				if(write) c->DSADR = val;
+				else val = c->DSADR;
+				break;
+
+			case 2:
+				if(write) c->DTADR = val;
+				else val = c->DTADR;
+				break;
+
+			case 3:
+				if(write) c->DCMD = val;
+				else val = c->DCMD;
+				break;
+		}
+	}
+
+	if(write) pxa255dmaPrvRecalcInt(dma);
+	else *(UInt32*)buf = val;
+
+	return true;
+}
+
+Boolean pxa255dmaInit(Pxa255dma* dma, ArmMem* physMem, Pxa255ic* ic){
+
+	UInt8 i;
+
+	__mem_zero(dma, sizeof(Pxa255dma));
+	dma->ic = ic;
+	dma->mem = physMem;
+
+	for(i = 0; i < PXA255_DMA_CHANNELS; i++) dma->channels[i].DCSR = DCSR_STOPSTATE;
+	pxa255dmaPrvRecalcChanReq(dma);
+
+	return memRegionAdd(physMem, PXA255_DMA_BASE, PXA255_DMA_SIZE, pxa255dmaPrvMemAccessF, dma);
+}
+
+void pxa255dmaSetReqF(Pxa255dma* dma, UInt8 req, Pxa255dmaReqF reqF, void* userData){
+
+	dma->reqF[req] = reqF;
+	dma->reqD[req] = userData;
+}
+
+Boolean pxa255dmaProcess(Pxa255dma* dma){
+
+	Boolean moved = false;
+	UInt8 i;
+
+	if(!dma->running) return false;
+
+	for(i = 0; i < PXA255_DMA_CHANNELS; i++) if((dma->running & (1U << i)) && pxa255dmaPrvChannelStep(dma, i)) moved = true;
+
+	pxa255dmaPrvRecalcInt(dma);
+
+	return moved;
+}
@@ -0,0 +1,68 @@
+#ifndef _PXA255_DMA_H_
+#define _PXA255_DMA_H_
+
+#include "mem.h"
+#include "cpu.h"
+#include "pxa255_IC.h"
+
+/*
+	PXA255 DMA controller
+
+	PURRPOSE: memcpy and serial I/O for drivers that want it
+
+	transfers do not happen on register writes, pxa255dmaProcess() runs them later (the SoC calls it
+	every so often while any channel runs). memory is moved in chunks with one memAccess() each where
+	the region allows bursts. flow-controlled channels move one burst each time their peripheral's
+	request function (see pxa255dmaSetReqF()) says it is ready. bus errors stop the channel.
+*/
+
+#define PXA255_DMA_BASE		0x40000000UL
+#define PXA255_DMA_SIZE		0x00010000UL
+
+#define PXA255_DMA_CHANNELS	16
+#define PXA255_DMA_REQS		40
+
+#define PXA255_DMA_REQ_BTUART_RX	4
+#define PXA255_DMA_REQ_BTUART_TX	5
+#define PXA255_DMA_REQ_FFUART_RX	6
+#define PXA255_DMA_REQ_FFUART_TX	7
+#define PXA255_DMA_REQ_STUART_RX	19
+#define PXA255_DMA_REQ_STUART_TX	20
+
+#define PXA255_DMA_STEP_BYTES	4096	//per channel per pxa255dmaProcess()
+#define PXA255_DMA_CHUNK	128	//bytes per memAccess() when bursts are allowed
+
+typedef Boolean (*Pxa255dmaReqF)(void* userData);	//does the peripheral want a burst moved now?
+
+typedef struct{
+
+	UInt32 DCSR;		//control/status
+	UInt32 DDADR;		//descriptor address
+	UInt32 DSADR;		//source address
+	UInt32 DTADR;		//target address
+	UInt32 DCMD;		//command
+
+}Pxa255dmaChannel;
+
+typedef struct{
+
+	Pxa255ic* ic;
+	ArmMem* mem;
+
+	UInt16 running;		//bitmask of channels with work to do
+
+	Pxa255dmaChannel channels[PXA255_DMA_CHANNELS];
+	UInt8 DRCMR[PXA255_DMA_REQS];		//request to channel map
+	UInt8 chanReq[PXA255_DMA_CHANNELS];	//reverse of the above, PXA255_DMA_REQS if none
+
+	Pxa255dmaReqF reqF[PXA255_DMA_REQS];
+	void* reqD[PXA255_DMA_REQS];
+
+}Pxa255dma;
+
+Boolean pxa255dmaInit(Pxa255dma* dma, ArmMem* physMem, Pxa255ic* ic);
+void pxa255dmaSetReqF(Pxa255dma* dma, UInt8 req, Pxa255dmaReqF reqF, void* userData);
+Boolean pxa255dmaProcess(Pxa255dma* dma);	//move up to PXA255_DMA_STEP_BYTES on every running channel, true if anything moved
+
+#endif
+
@@ -0,0 +1,101 @@
+#include "pxa255_DSP.h"
+
+
+static _INLINE_ UInt64 pxa255dspPrvTrunc(UInt64 v){
+
+	return u64_and(v, u64_from_halves(PXA255_DSP_ACC_HI_MASK, 0xFFFFFFFFUL));
+}
+
+#ifdef PXA255_DSP_MULACC
+
+#define PXA255_DSP_MIA		0x00	//opcode_3 (CRn field) values
+#define PXA255_DSP_MIAPH	0x08
+#define PXA255_DSP_MIAxy	0x0C	//low two bits pick the top halves of Rm and Rs
+
+
+static Boolean pxa255dspPrvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	Pxa255dsp* dsp = userData;
+	UInt32 rm, rs;
+	UInt64 acc;
+
+	if(two || read || op1 != 1 || op2 != 0) return false;		//MIA* only: MCR with op1 == 1, op2 is the accumulator and only acc0 exists
+
+	rs = cpuGetRegExternal(cpu, Rx);
+	rm = cpuGetRegExternal(cpu, CRm);
+	acc = dsp->acc0;
+
+	switch(CRn){
+
+		case PXA255_DSP_MIA:
+			acc = u64_add(acc, u64_smul3232((Int32)rm, (Int32)rs));
+			break;
+
+		case PXA255_DSP_MIAPH:
+			acc = u64_add(acc, u64_smul3232((Int16)rm, (Int16)rs));
+			acc = u64_add(acc, u64_smul3232((Int16)(rm >> 16), (Int16)(rs >> 16)));
+			break;
+
+		case PXA255_DSP_MIAxy + 0:	//MIABB
+		case PXA255_DSP_MIAxy + 1:	//MIABT
+		case PXA255_DSP_MIAxy + 2:	//MIATB
+		case PXA255_DSP_MIAxy + 3:	//MIATT
+			if(CRn & 2) rm >>= 16;
+			if(CRn & 1) rs >>= 16;
+			acc = u64_add(acc, u64_smul3232((Int16)rm, (Int16)rs));
+			break;
+
+		default:
+			return false;
+	}
+
+	dsp->acc0 = pxa255dspPrvTrunc(acc);
+	return true;
+}
+
+#endif
+
+static Boolean pxa255dspPrvCoproc2RegXferFunc(struct ArmCpu* cpu, void* userData, Boolean MRRC, UInt8 op, UInt8 RdLo, UInt8 RdHi, UInt8 CRm){
+
+	Pxa255dsp* dsp = userData;
+	UInt32 hi;
+
+	if(op != 0 || CRm != 0) return false;		//acc0 is the only accumulator
+
+	if(MRRC){	//MRA: top 8 bits come back sign-extended
+
+		hi = u64_get_hi(dsp->acc0);
+		if(hi & 0x80) hi |= ~PXA255_DSP_ACC_HI_MASK;
+
+		cpuSetReg(cpu, RdLo, u64_64_to_32(dsp->acc0));
+		cpuSetReg(cpu, RdHi, hi);
+	}
+	else{		//MAR
+
+		dsp->acc0 = pxa255dspPrvTrunc(u64_from_halves(cpuGetRegExternal(cpu, RdHi), cpuGetRegExternal(cpu, RdLo)));
+	}
+
+	return true;
+}
+
+Boolean pxa255dspInit(Pxa255dsp* dsp, ArmCpu* cpu){
+
+	ArmCoprocessor cp;
+
+	__mem_zero(dsp, sizeof(Pxa255dsp));
+	dsp->cpu = cpu;
+
+#ifdef PXA255_DSP_MULACC
+	cp.regXfer = pxa255dspPrvCoprocRegXferFunc;
+#else
+	cp.regXfer = NULL;
+#endif
+	cp.dataProcessing = NULL;
+	cp.memAccess = NULL;
+	cp.twoRegF = pxa255dspPrvCoproc2RegXferFunc;
+	cp.userData = dsp;
+
+	cpuCoprocessorRegister(cpu, 0, &cp);
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#ifndef _PXA255_DSP_H_
+#define _PXA255_DSP_H_
+
+#include "types.h"
+#include "CPU.h"
+#include "math64.h"
+
+/*
+	PXA255 DSP coprocessor (cp0)
+
+	PURRPOSE: linux saves and restores acc0 on every task switch (MRA/MAR), and code built for xscale uses the MIA* multiply-accumulates
+
+	one 40-bit accumulator, acc0. MAR/MRA are MCRR/MRRC on cp0, the MIA* forms are MCR encodings on cp0 with op1 == 1,
+	so both go straight to our twoRegF and regXfer callbacks with no extra decoding in the cpu.
+
+	without PXA255_DSP_MULACC only MAR/MRA exist, which is all linux needs (xscale_cp0_init and the task switch)
+	and MIA* becomes an undefined instr. EMBEDDED goes without it: the 64-bit multiply-adds are most of the
+	~800 bytes of AVR flash the full unit costs.
+*/
+
+#ifndef EMBEDDED
+	#define PXA255_DSP_MULACC	//MIA, MIAPH, MIAxy
+#endif
+
+#define PXA255_DSP_ACC_HI_MASK	0x000000FFUL	//acc0 bits 39..32
+
+typedef struct{
+
+	ArmCpu* cpu;
+	UInt64 acc0;		//kept truncated to 40 bits
+
+}Pxa255dsp;
+
+Boolean pxa255dspInit(Pxa255dsp* dsp, ArmCpu* cpu);
+
+#endif
@@ -94,7 +94,7 @@ void pxa255icInt(Pxa255ic* ic, UInt8 intNum, Boolean raise){		//interrupt caused
 	
 	if(new_ != old_){
 		ic->ICPR = new_;
-		pxa255icPrvHandleChanges(ic);
+		if((new_ ^ old_) & ic->ICMR) pxa255icPrvHandleChanges(ic);	//masked ones change nothing for the cpu
 	}
 }
 
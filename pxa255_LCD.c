@@ -0,0 +1,374 @@
+#include "pxa255_LCD.h"
+#include "mem.h"
+
+
+#define LCCR0_ENB		0x00000001UL	//enable
+#define LCCR0_LDM		0x00000008UL	//disable done int mask
+#define LCCR0_SFM		0x00000010UL	//start of frame int mask
+#define LCCR0_IUM		0x00000020UL	//input underrun int mask
+#define LCCR0_EFM		0x00000040UL	//end of frame int mask
+#define LCCR0_DIS		0x00000400UL	//disable at end of frame
+#define LCCR0_QDM		0x00000800UL	//quick disable int mask
+#define LCCR0_BM		0x00100000UL	//branch int mask
+#define LCCR0_OUM		0x00200000UL	//output underrun int mask
+
+#define LCSR_LDD		0x00000001UL	//disable done
+#define LCSR_SOF		0x00000002UL	//start of frame
+#define LCSR_BER		0x00000004UL	//bus error
+#define LCSR_ABC		0x00000008UL
+#define LCSR_IUL		0x00000010UL
+#define LCSR_IUU		0x00000020UL
+#define LCSR_OU			0x00000040UL
+#define LCSR_QD			0x00000080UL	//quick disable
+#define LCSR_EOF		0x00000100UL	//end of frame
+#define LCSR_BS			0x00000200UL	//branch taken
+#define LCSR_SINT		0x00000400UL
+
+#define LDCMD_PAL		0x04000000UL	//palette, not pixels
+#define LDCMD_SOFINT		0x00400000UL
+#define LDCMD_EOFINT		0x00200000UL
+#define LDCMD_LEN_MASK		0x001FFFFFUL
+
+#define FBR_BRA			0x00000001UL	//branch at next frame
+#define FBR_BINT		0x00000002UL	//and say so
+
+#define FDADR0_OFST		0x0200UL
+#define FDADR1_OFST		0x0210UL
+
+#define PXA255_LCD_MAX_DESCS	4	//followed per frame, palettes then pixels
+
+
+static void pxa255lcdPrvRecalcInt(Pxa255lcd* lcd){
+
+	UInt32 masked = 0, c0 = lcd->LCCR[0];
+
+	if(c0 & LCCR0_LDM) masked |= LCSR_LDD;
+	if(c0 & LCCR0_SFM) masked |= LCSR_SOF;
+	if(c0 & LCCR0_IUM) masked |= LCSR_IUL | LCSR_IUU;
+	if(c0 & LCCR0_EFM) masked |= LCSR_EOF;
+	if(c0 & LCCR0_QDM) masked |= LCSR_QD;
+	if(c0 & LCCR0_BM) masked |= LCSR_BS;
+	if(c0 & LCCR0_OUM) masked |= LCSR_OU;
+
+	pxa255icInt(lcd->ic, PXA255_I_LCD, (lcd->LCSR &~ masked) != 0);
+}
+
+static void pxa255lcdPrvSchedule(Pxa255lcd* lcd){
+
+	lcd->due = *lcd->cycles + ((lcd->LCCR[0] & LCCR0_ENB) ? lcd->cyclesPerSec / PXA255_LCD_FPS : lcd->cyclesPerSec);
+}
+
+static void pxa255lcdPrvEnable(Pxa255lcd* lcd, Boolean on){	//RAM only tracks writes for us while we show something
+
+	if(on){
+		lcd->redraw = true;
+		__mem_zero(lcd->dirty, sizeof(lcd->dirty));
+	}
+#ifndef EMBEDDED	//only host builds have an LCD, and only their RAM tracks writes
+	if(lcd->ram) ramTrackDirty(lcd->ram, on ? lcd->dirty : NULL);
+#endif
+}
+
+static const UInt8* pxa255lcdPrvRamPtr(Pxa255lcd* lcd, UInt32 pa, UInt32 len){	//host pointer to guest RAM if all of it is there
+
+	if(!lcd->ram) return NULL;
+	pa -= lcd->ram->adr;
+	if(pa >= lcd->ram->sz || lcd->ram->sz - pa < len) return NULL;
+
+	return (const UInt8*)lcd->ram->buf + pa;
+}
+
+static Boolean pxa255lcdPrvRead(Pxa255lcd* lcd, UInt32 pa, UInt8* buf, UInt32 len){	//when not in RAM: by words, len is a multiple of 4
+
+	const UInt8* src = pxa255lcdPrvRamPtr(lcd, pa, len);
+
+	if(src){
+		__mem_copy(buf, src, len);
+		return true;
+	}
+	for(; len; len -= 4, pa += 4, buf += 4) if(!memAccess(lcd->mem, pa, 4, false, buf)) return false;
+
+	return true;
+}
+
+static Boolean pxa255lcdPrvRowDirty(Pxa255lcd* lcd, UInt32 pa, UInt32 len){
+
+	UInt32 first, last;
+
+	if(lcd->redraw || !pxa255lcdPrvRamPtr(lcd, pa, len)) return true;
+
+	pa -= lcd->ram->adr;
+	first = pa >> RAM_DIRTY_PAGE_SHIFT;
+	last = (pa + len - 1) >> RAM_DIRTY_PAGE_SHIFT;
+
+	for(; first <= last; first++) if(lcd->dirty[first >> 5] & (1UL << (first & 31))) return true;
+
+	return false;
+}
+
+static void pxa255lcdPrvConvertRow(Pxa255lcd* lcd, const UInt8* src, UInt16 width, UInt8 bppShift){
+
+	UInt8 bits = 1 << bppShift, mask = (1 << bits) - 1, v;
+	UInt16 i;
+
+	if(bppShift == 4){
+		for(i = 0; i < width; i++) lcd->row[i] = ((const UInt16*)src)[i];	//our memory system is little-endian
+		return;
+	}
+
+	for(i = 0; i < width; i++){	//palettized, first pixel in the low bits of a byte
+
+		v = src[(i << bppShift) >> 3] >> ((i << bppShift) & 7);
+		lcd->row[i] = lcd->palette[v & mask];
+	}
+}
+
+static void pxa255lcdPrvDraw(Pxa255lcd* lcd, UInt32 fb, UInt32 len){
+
+	UInt16 width = (lcd->LCCR[1] & 0x3FF) + 1, height = (lcd->LCCR[2] & 0x3FF) + 1, r;
+	UInt8 bppShift = (lcd->LCCR[3] >> 24) & 7;	//BPP field: 1, 2, 4, 8, 16 bits
+	UInt32 stride, geom, first, last, i;
+	UInt32 buf[PXA255_LCD_MAX_WIDTH * 2 / sizeof(UInt32)];
+	const UInt8* src;
+	Boolean any = false;
+
+	if(bppShift > 4) bppShift = 4;
+	stride = (((UInt32)width << bppShift) + 31) / 32 * 4;	//lines are whole words
+	if(len / stride < height) height = len / stride;
+	if(!height) return;
+
+	geom = ((UInt32)width << 16) | ((UInt32)height << 4) | bppShift;
+	if(geom != lcd->lastGeom || fb != lcd->lastFb) lcd->redraw = true;
+	lcd->lastGeom = geom;
+	lcd->lastFb = fb;
+
+	for(r = 0; r < height; r++, fb += stride){
+
+		if(!pxa255lcdPrvRowDirty(lcd, fb, stride)) continue;
+
+		src = pxa255lcdPrvRamPtr(lcd, fb, stride);
+		if(!src){
+			if(!pxa255lcdPrvRead(lcd, fb, (UInt8*)buf, stride)){
+				lcd->LCSR |= LCSR_BER;
+				break;
+			}
+			src = (const UInt8*)buf;
+		}
+		pxa255lcdPrvConvertRow(lcd, src, width, bppShift);
+		if(lcd->outF) lcd->outF(lcd->outD, width, height, r, lcd->row);
+		any = true;
+	}
+
+	if(any && lcd->outF) lcd->outF(lcd->outD, width, height, height, NULL);
+
+	if(lcd->ram){	//frame is out, forget writes to it
+
+		first = (lcd->lastFb - lcd->ram->adr) >> RAM_DIRTY_PAGE_SHIFT;
+		last = (lcd->lastFb - lcd->ram->adr + stride * height - 1) >> RAM_DIRTY_PAGE_SHIFT;
+		for(i = first; i <= last && i < (lcd->ram->sz >> RAM_DIRTY_PAGE_SHIFT); i++) lcd->dirty[i >> 5] &=~ (1UL << (i & 31));
+	}
+	lcd->redraw = false;
+}
+
+static void pxa255lcdPrvLoadPalette(Pxa255lcd* lcd, UInt32 pa, UInt32 len){
+
+	UInt16 pal[256], i;
+
+	if(len > sizeof(pal)) len = sizeof(pal);
+	len &=~ 3UL;
+
+	if(!pxa255lcdPrvRead(lcd, pa, (UInt8*)pal, len)){
+		lcd->LCSR |= LCSR_BER;
+		return;
+	}
+	for(i = 0; i < len / 2; i++){	//linux reloads it every frame, only a real change needs a full redraw
+
+		if(lcd->palette[i] == pal[i]) continue;
+		lcd->palette[i] = pal[i];
+		lcd->redraw = true;
+	}
+}
+
+static void pxa255lcdPrvDoFrame(Pxa255lcd* lcd){
+
+	Pxa255lcdChannel* c = &lcd->ch[0];
+	UInt32 desc[4];
+	UInt8 i;
+
+	if(lcd->FBR[0] & FBR_BRA){
+
+		c->FDADR = lcd->FBR[0] &~ 0x0FUL;
+		if(lcd->FBR[0] & FBR_BINT) lcd->LCSR |= LCSR_BS;
+		lcd->FBR[0] = 0;
+	}
+
+	for(i = 0; i < PXA255_LCD_MAX_DESCS; i++){
+
+		if(!pxa255lcdPrvRead(lcd, c->FDADR &~ 0x0FUL, (UInt8*)desc, sizeof(desc))){
+			lcd->LCSR |= LCSR_BER;
+			break;
+		}
+		c->FDADR = desc[0];
+		c->FSADR = desc[1];
+		c->FIDR = desc[2];
+		c->LDCMD = desc[3];
+		if(c->LDCMD & LDCMD_SOFINT){
+			lcd->LCSR |= LCSR_SOF;
+			lcd->LIIDR = c->FIDR;
+		}
+
+		if(c->LDCMD & LDCMD_PAL) pxa255lcdPrvLoadPalette(lcd, c->FSADR, c->LDCMD & LDCMD_LEN_MASK);
+		else{
+			pxa255lcdPrvDraw(lcd, c->FSADR, c->LDCMD & LDCMD_LEN_MASK);
+			if(c->LDCMD & LDCMD_EOFINT){
+				lcd->LCSR |= LCSR_EOF;
+				lcd->LIIDR = c->FIDR;
+			}
+			break;
+		}
+	}
+}
+
+static void pxa255lcdPrvLccr0Write(Pxa255lcd* lcd, UInt32 val){
+
+	Boolean was = (lcd->LCCR[0] & LCCR0_ENB) != 0;
+
+	if(was && (val & LCCR0_ENB) && (val & LCCR0_DIS)){	//off at the end of this frame, which is now
+
+		val &=~ LCCR0_ENB;
+		lcd->LCSR |= LCSR_LDD;
+	}
+	else if(was && !(val & LCCR0_ENB)) lcd->LCSR |= LCSR_QD;
+
+	lcd->LCCR[0] = val;
+
+	if(was != !!(val & LCCR0_ENB)){
+
+		pxa255lcdPrvEnable(lcd, !was);
+		pxa255lcdPrvSchedule(lcd);
+	}
+}
+
+static Boolean pxa255lcdPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255lcd* lcd = userData;
+	UInt32 val = 0;
+	Pxa255lcdChannel* c;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+	//	err_str(write ? "write" : "read");
+	//	err_str(" of ");
+	//	err_dec(size);
+	//	err_str(" bytes to 0x");
+	//	err_hex(pa);
+	//	err_str("\r\n");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa -= PXA255_LCD_BASE;
+	if(write) val = *(UInt32*)buf;
+
+	if(pa >= FDADR0_OFST && pa < FDADR1_OFST + 0x10){
+
+		c = &lcd->ch[(pa - FDADR0_OFST) >> 4];
+		switch((pa >> 2) & 3){
+
+			case 0:
+				if(write) c->FDADR = val;
+				else val = c->FDADR;
+				break;
+
+			case 1:
+				if(!write) val = c->FSADR;
+				break;
+
+			case 2:
+				if(!write) val = c->FIDR;
+				break;
+
+			case 3:
+				if(!write) val = c->LDCMD;
+				break;
+		}
+	}
+	else switch(pa >> 2){
+
+		case 0:
+			if(write) pxa255lcdPrvLccr0Write(lcd, val);
+			else val = lcd->LCCR[0];
+			break;
+
+		case 1:
+		case 2:
+		case 3:
+			if(write) lcd->LCCR[pa >> 2] = val;
+			else val = lcd->LCCR[pa >> 2];
+			break;
+
+		case 8:
+		case 9:
+			if(write) lcd->FBR[pa & 4 ? 1 : 0] = val;
+			else val = lcd->FBR[pa & 4 ? 1 : 0];
+			break;
+
+		case 14:
+			if(write) lcd->LCSR &=~ val;	//write 1 to clear
+			else val = lcd->LCSR;
+			break;
+
+		case 15:
+			if(!write) val = lcd->LIIDR;
+			break;
+
+		case 16:
+			if(write) lcd->TRGBR = val;
+			else val = lcd->TRGBR;
+			break;
+
+		case 17:
+			if(write) lcd->TCR = val;
+			else val = lcd->TCR;
+			break;
+	}
+
+	if(write) pxa255lcdPrvRecalcInt(lcd);
+	else *(UInt32*)buf = val;
+
+	return true;
+}
+
+Boolean pxa255lcdInit(Pxa255lcd* lcd, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles, UInt32 cyclesPerSec){
+
+	__mem_zero(lcd, sizeof(Pxa255lcd));
+	lcd->ic = ic;
+	lcd->mem = physMem;
+	lcd->cycles = cycles;
+	lcd->cyclesPerSec = cyclesPerSec;
+	pxa255lcdPrvSchedule(lcd);
+
+	return memRegionAdd(physMem, PXA255_LCD_BASE, PXA255_LCD_SIZE, pxa255lcdPrvMemAccessF, lcd);
+}
+
+void pxa255lcdSetRam(Pxa255lcd* lcd, ArmRam* ram){
+
+	if(ram && ram->sz > PXA255_LCD_MAX_RAM) ram = NULL;	//cannot track it, send every row every frame
+	lcd->ram = ram;
+}
+
+void pxa255lcdSetOutF(Pxa255lcd* lcd, Pxa255lcdOutF outF, void* userData){
+
+	lcd->outF = outF;
+	lcd->outD = userData;
+	lcd->redraw = true;
+}
+
+void pxa255lcdFrame(Pxa255lcd* lcd){
+
+	if(lcd->LCCR[0] & LCCR0_ENB){
+
+		pxa255lcdPrvDoFrame(lcd);
+		pxa255lcdPrvRecalcInt(lcd);
+	}
+	pxa255lcdPrvSchedule(lcd);
+}
@@ -0,0 +1,77 @@
+#ifndef _PXA255_LCD_H_
+#define _PXA255_LCD_H_
+
+#include "mem.h"
+#include "cpu.h"
+#include "RAM.h"
+#include "pxa255_IC.h"
+
+/*
+	PXA255 LCD controller
+
+	PURRPOSE: framebuffer for the guest
+
+	frames are not tied to register accesses, the SoC calls pxa255lcdFrame() when its cycle counter
+	reaches "due" (PXA255_LCD_FPS times a guest second while enabled). only channel 0 is done (single
+	panel), palette descriptors chained before the frame one are followed. pixels go out as RGB565,
+	a row at a time, and only rows that sit on RAM pages the guest wrote since the last frame: RAM
+	tells us which (see ramTrackDirty()) while the controller is on. with no RAM given every row is
+	sent every frame.
+*/
+
+#define PXA255_LCD_BASE		0x44000000UL
+#define PXA255_LCD_SIZE		0x00001000UL
+
+#define PXA255_LCD_FPS		60
+#define PXA255_LCD_MAX_WIDTH	1024
+#define PXA255_LCD_MAX_RAM	0x04000000UL	//biggest RAM we can track writes to
+
+typedef void (*Pxa255lcdOutF)(void* userData, UInt16 width, UInt16 height, UInt16 row, const UInt16* pixels);	//one changed row in RGB565, pixels == NULL ends a frame that had some
+
+typedef struct{
+
+	UInt32 FDADR;		//frame descriptor address
+	UInt32 FSADR;		//frame source address
+	UInt32 FIDR;		//frame id
+	UInt32 LDCMD;		//command
+
+}Pxa255lcdChannel;
+
+typedef struct{
+
+	Pxa255ic* ic;
+	ArmMem* mem;
+	ArmRam* ram;		//where framebuffers are expected, NULL if writes to it cannot be tracked
+	const UInt32* cycles;	//SoC's cycle counter
+	UInt32 cyclesPerSec;
+
+	UInt32 due;		//cycle count of the next frame
+
+	Pxa255lcdOutF outF;
+	void* outD;
+
+	UInt32 LCCR[4];		//control
+	UInt32 FBR[2];		//branch
+	UInt32 LCSR;		//status
+	UInt32 LIIDR;		//interrupt id
+	UInt32 TRGBR;		//TMED RGB seed
+	UInt32 TCR;		//TMED control
+	Pxa255lcdChannel ch[2];
+
+	UInt32 lastFb;		//what we drew last time, so changes force a full frame
+	UInt32 lastGeom;
+	Boolean redraw;
+
+	UInt16 palette[256];
+	UInt16 row[PXA255_LCD_MAX_WIDTH];
+	UInt32 dirty[PXA255_LCD_MAX_RAM >> RAM_DIRTY_PAGE_SHIFT >> 5];
+
+}Pxa255lcd;
+
+Boolean pxa255lcdInit(Pxa255lcd* lcd, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles, UInt32 cyclesPerSec);
+void pxa255lcdSetRam(Pxa255lcd* lcd, ArmRam* ram);
+void pxa255lcdSetOutF(Pxa255lcd* lcd, Pxa255lcdOutF outF, void* userData);
+void pxa255lcdFrame(Pxa255lcd* lcd);		//draw a frame if enabled and find when the next one is
+
+#endif
+
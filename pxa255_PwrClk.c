@@ -0,0 +1,144 @@
+#include "pxa255_PwrClk.h"
+#include "mem.h"
+
+
+#define PXA255_PWR_RCSR		12	//reset controller status, word index
+#define PXA255_PWR_RCSR_HWR	0x00000001UL	//hardware reset
+
+#define PXA255_PWRMODE_IDLE	1
+
+
+static Boolean pxa255pwrClkPrvCoprocRegXferFunc(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	Pxa255pwrClk* pc = userData;
+	UInt32 val = 0;
+
+	if(!read) val = cpuGetRegExternal(cpu, Rx);
+
+	if(op1 != 0 || op2 != 0 || CRm != 0 || two) goto fail;		//CP14 only accessed with MCR/MRC with op1 == op2 == CRm == 0
+
+	switch(CRn){
+
+#ifndef EMBEDDED
+		case 0:		//PMNC
+		case 1:		//CCNT
+		case 2:		//PMN0
+		case 3:		//PMN1
+			if(read) val = pc->PMU[CRn];
+			else pc->PMU[CRn] = val;
+			goto success;
+
+		case 6:		//CCLKCFG
+			if(read) val = pc->CCLKCFG;
+			else pc->CCLKCFG = val;
+			goto success;
+#endif
+
+		case 7:		//PWRMODE
+			if(read) val = 0;
+			else if(val & 3) cpuSleep(pc->cpu);	//IDLE, or sleep which we cannot do, so idle instead
+			goto success;
+	}
+
+fail:
+	return false;
+
+success:
+
+	if(read) cpuSetReg(cpu, Rx, val);
+	return true;
+}
+
+#ifndef EMBEDDED
+
+static Boolean pxa255pwrClkPrvClockMgrMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255pwrClk* pc = userData;
+	UInt32 val = 0;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa = (pa - PXA255_CLOCK_MANAGER_BASE) >> 2;
+
+	if(write) val = *(UInt32*)buf;
+
+	switch(pa){
+
+		case 0:		//CCCR
+			if(write) pc->CCCR = val;
+			else val = pc->CCCR;
+			break;
+
+		case 1:		//CKEN
+			if(write) pc->CKEN = val;
+			else val = pc->CKEN;
+			break;
+
+		case 2:		//OSCC
+			if(write){
+				if(val & 2) pc->OSCC |= 3;	//32KHz oscillator is on and stable right away
+			}
+			else val = pc->OSCC;
+			break;
+	}
+
+	if(!write) *(UInt32*)buf = val;
+	return true;
+}
+
+static Boolean pxa255pwrClkPrvPowerMgrMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255pwrClk* pc = userData;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa = (pa - PXA255_PWR_BASE) >> 2;
+	if(pa >= sizeof(pc->pwrRegs) / sizeof(*pc->pwrRegs)){
+
+		if(!write) *(UInt32*)buf = 0;
+	}
+	else if(write){
+
+		if(pa == PXA255_PWR_RCSR) pc->pwrRegs[pa] &=~ *(UInt32*)buf;	//write 1 to clear
+		else pc->pwrRegs[pa] = *(UInt32*)buf;
+	}
+	else *(UInt32*)buf = pc->pwrRegs[pa];
+
+	return true;
+}
+
+#endif
+
+Boolean pxa255pwrClkInit(Pxa255pwrClk* pc, ArmCpu* cpu, _UNUSED_ ArmMem* physMem){
+
+	ArmCoprocessor cp;
+
+	__mem_zero(pc, sizeof(Pxa255pwrClk));
+	pc->cpu = cpu;
+#ifndef EMBEDDED
+	pc->CCCR = 0x00000121UL;	//reset values: 99.5MHz memory, run = turbo = 199.1MHz
+	pc->CKEN = 0x00017DEFUL;
+	pc->pwrRegs[PXA255_PWR_RCSR] = PXA255_PWR_RCSR_HWR;
+#endif
+
+	cp.regXfer = pxa255pwrClkPrvCoprocRegXferFunc;
+	cp.dataProcessing = NULL;
+	cp.memAccess = NULL;
+	cp.twoRegF = NULL;
+	cp.userData = pc;
+
+	cpuCoprocessorRegister(cpu, 14, &cp);
+
+#ifdef EMBEDDED
+	return true;
+#else
+	return memRegionAdd(physMem, PXA255_CLOCK_MANAGER_BASE, PXA255_CLOCK_MANAGER_SIZE, pxa255pwrClkPrvClockMgrMemAccessF, pc) &&
+		memRegionAdd(physMem, PXA255_PWR_BASE, PXA255_PWR_SIZE, pxa255pwrClkPrvPowerMgrMemAccessF, pc);
+#endif
+}
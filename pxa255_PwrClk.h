@@ -0,0 +1,41 @@
+#ifndef _PXA255_PWR_CLK_H_
+#define _PXA255_PWR_CLK_H_
+
+#include "mem.h"
+#include "cpu.h"
+
+/*
+	PXA255 power and clock managers, and the cp14 regs that go with them
+
+	PURRPOSE: linux reads clock setup from here and idles the cpu through PWRMODE.
+		  IDLE mode puts the cpu to sleep until an interrupt (see cpuSleep()), deeper modes are treated the same.
+		  performance monitor counters just hold what is written to them
+		  EMBEDDED builds only have PWRMODE, the registers cost flash and SRAM the AVR does not have
+*/
+
+#define PXA255_PWR_BASE		0x40F00000UL
+#define PXA255_PWR_SIZE		0x00010000UL
+
+#define PXA255_CLOCK_MANAGER_BASE	0x41300000UL
+#define PXA255_CLOCK_MANAGER_SIZE	0x00010000UL
+
+typedef struct{
+
+	ArmCpu* cpu;
+
+#ifndef EMBEDDED
+	UInt32 CCCR;		//core clock configuration
+	UInt32 CKEN;		//clock enables
+	UInt32 OSCC;		//oscillator configuration
+	UInt32 CCLKCFG;		//cp14 core clock config (turbo, freq change)
+	UInt32 PMU[4];		//cp14 PMNC, CCNT, PMN0, PMN1
+
+	UInt32 pwrRegs[13];	//PMCR..PMFW, only RCSR has a non-zero reset value
+#endif
+
+}Pxa255pwrClk;
+
+Boolean pxa255pwrClkInit(Pxa255pwrClk* pc, ArmCpu* cpu, ArmMem* physMem);
+
+#endif
+
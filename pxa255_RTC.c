@@ -0,0 +1,148 @@
+#include "pxa255_RTC.h"
+#include "mem.h"
+
+
+#define RTSR_AL			0x00000001UL	//alarm happened
+#define RTSR_HZ			0x00000002UL	//1Hz tick happened
+#define RTSR_ALE		0x00000004UL	//alarm interrupt enable
+#define RTSR_HZE		0x00000008UL	//1Hz interrupt enable
+
+#define PXA255_RTC_POLLS_PER_SEC	8	//how often to look during the second before the one we wait for
+#define PXA255_RTC_RATE_SECS		8	//host seconds the host rate is averaged over
+#define PXA255_RTC_MAX_WAIT_SEC		60	//keeps "due" well inside 2^31 cycles
+
+
+static void pxa255rtcPrvRaiseLowerInts(Pxa255rtc* rtc){
+
+	pxa255icInt(rtc->ic, PXA255_I_RTC_ALM, (rtc->RTSR & (RTSR_AL | RTSR_ALE)) == (RTSR_AL | RTSR_ALE));
+	pxa255icInt(rtc->ic, PXA255_I_RTC_HZ, (rtc->RTSR & (RTSR_HZ | RTSR_HZE)) == (RTSR_HZ | RTSR_HZE));
+}
+
+static void pxa255rtcPrvSync(Pxa255rtc* rtc){
+
+	UInt32 host = rtcCurTime(), now = host + rtc->offset;
+	UInt32 passed = now - rtc->lastSec, t;
+
+	if(!passed) return;
+
+	t = host - rtc->rateSec;
+	if(t){
+
+		if((*rtc->cycles - rtc->rateCycles) / t) rtc->hostRate = (*rtc->cycles - rtc->rateCycles) / t;
+		if(t >= PXA255_RTC_RATE_SECS){	//start over so the rate follows the host's load
+
+			rtc->rateSec = host;
+			rtc->rateCycles = *rtc->cycles;
+		}
+	}
+
+	rtc->RTSR |= RTSR_HZ;
+	if(rtc->RTAR - rtc->lastSec - 1 < passed) rtc->RTSR |= RTSR_AL;	//went past the alarm time
+	rtc->lastSec = now;
+}
+
+static void pxa255rtcPrvSchedule(Pxa255rtc* rtc){	//RCNR runs on host time, which guest cycles only match at full speed: till the second before the wanted one look once a host second, then poll
+
+	UInt32 wait = PXA255_RTC_MAX_WAIT_SEC * rtc->cyclesPerSec, secs = 0;
+
+	if(rtc->RTSR & RTSR_HZE) secs = 1;
+	else if(rtc->RTSR & RTSR_ALE) secs = rtc->RTAR - rtc->lastSec;	//0 once the alarm second is here: nothing to wait for
+
+	if(secs == 1) wait = rtc->hostRate / PXA255_RTC_POLLS_PER_SEC + 1;
+	else if(secs && rtc->hostRate < wait) wait = rtc->hostRate;	//(secs - 1) host seconds away, capped at one as the rate may change under us
+
+	rtc->due = *rtc->cycles + wait;
+}
+
+static Boolean pxa255rtcPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255rtc* rtc = userData;
+	UInt32 val = 0;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+	//	err_str(write ? "write" : "read");
+	//	err_str(" of ");
+	//	err_dec(size);
+	//	err_str(" bytes to 0x");
+	//	err_hex(pa);
+	//	err_str("\r\n");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa = (pa - PXA255_RTC_BASE) >> 2;
+
+	pxa255rtcPrvSync(rtc);
+
+	if(write){
+		val = *(UInt32*)buf;
+		switch(pa){
+
+			case 0:
+				rtc->offset = val - rtcCurTime();
+				rtc->lastSec = val;
+				break;
+
+			case 1:
+				rtc->RTAR = val;
+				break;
+
+			case 2:
+				rtc->RTSR &=~ (val & (RTSR_AL | RTSR_HZ));	//write 1 to clear
+				rtc->RTSR = (rtc->RTSR &~ (RTSR_ALE | RTSR_HZE)) | (val & (RTSR_ALE | RTSR_HZE));
+				break;
+
+			case 3:
+				rtc->RTTR = val;
+				break;
+		}
+		pxa255rtcPrvSchedule(rtc);
+	}
+	else{
+		switch(pa){
+
+			case 0:
+				val = rtc->lastSec;
+				break;
+
+			case 1:
+				val = rtc->RTAR;
+				break;
+
+			case 2:
+				val = rtc->RTSR;
+				break;
+
+			case 3:
+				val = rtc->RTTR;
+				break;
+		}
+		*(UInt32*)buf = val;
+	}
+	pxa255rtcPrvRaiseLowerInts(rtc);
+
+	return true;
+}
+
+Boolean pxa255rtcInit(Pxa255rtc* rtc, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles, UInt32 cyclesPerSec){
+
+	__mem_zero(rtc, sizeof(Pxa255rtc));
+	rtc->ic = ic;
+	rtc->cycles = cycles;
+	rtc->cyclesPerSec = cyclesPerSec;
+	rtc->lastSec = rtcCurTime();
+	rtc->rateSec = rtc->lastSec;
+	rtc->rateCycles = *cycles;
+	rtc->hostRate = cyclesPerSec / PXA255_RTC_POLLS_PER_SEC;	//low till a host second has been seen to pass, to not overshoot before then
+	rtc->RTTR = 0x00007FFFUL;	//as a bootloader would leave it: 32.768KHz crystal, no trim. linux zeroes the clock if it finds 0 here
+	pxa255rtcPrvSchedule(rtc);
+
+	return memRegionAdd(physMem, PXA255_RTC_BASE, PXA255_RTC_SIZE, pxa255rtcPrvMemAccessF, rtc);
+}
+
+void pxa255rtcUpdate(Pxa255rtc* rtc){
+
+	pxa255rtcPrvSync(rtc);
+	pxa255rtcPrvRaiseLowerInts(rtc);
+	pxa255rtcPrvSchedule(rtc);
+}
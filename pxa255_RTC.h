@@ -0,0 +1,47 @@
+#ifndef _PXA255_RTC_H_
+#define _PXA255_RTC_H_
+
+#include "mem.h"
+#include "cpu.h"
+#include "pxa255_IC.h"
+
+/*
+	PXA255 real time clock
+
+	PURRPOSE: wall time for the guest
+
+	RCNR is rtcCurTime() plus whatever the guest set it to, worked out when read.
+	alarm and 1Hz interrupts are found by pxa255rtcUpdate() which the SoC calls
+	when its cycle counter reaches "due". with either enabled that is a few times
+	a second during the second before the wanted one and about once a host
+	second (going by the cycles host seconds have been taking) before that,
+	else hardly ever.
+*/
+
+#define PXA255_RTC_BASE		0x40900000UL
+#define PXA255_RTC_SIZE		0x00010000UL
+
+typedef struct{
+
+	Pxa255ic* ic;
+	const UInt32* cycles;	//SoC's cycle counter
+	UInt32 cyclesPerSec;
+
+	UInt32 due;		//cycle count at which to look at the time again
+	UInt32 lastSec;		//RCNR at the last look
+	UInt32 rateSec;		//rtcCurTime() when the host rate measurement started
+	UInt32 rateCycles;	//cycle count then
+	UInt32 hostRate;	//cycles per host second, averaged since then
+	UInt32 offset;		//RCNR - rtcCurTime()
+
+	UInt32 RTAR;		//alarm
+	UInt32 RTSR;		//status
+	UInt32 RTTR;		//trim, kept but unused
+
+}Pxa255rtc;
+
+Boolean pxa255rtcInit(Pxa255rtc* rtc, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles, UInt32 cyclesPerSec);
+void pxa255rtcUpdate(Pxa255rtc* rtc);
+
+#endif
+
@@ -0,0 +1,146 @@
+#include "pxa255_TIMR.h"
+#include "mem.h"
+
+
+#define PXA255_TIMR_MAX_WAIT	0x08000000UL	//ticks, resync at least this often so cycle count differences never wrap
+
+
+static void pxa255timrPrvRaiseLowerInts(Pxa255timr* timr){
+
+	UInt8 i;
+
+	for(i = 0; i < 4; i++) pxa255icInt(timr->ic, PXA255_I_TIMR0 + i, (timr->OSSR & timr->OIER & (1UL << i)) != 0);
+}
+
+static void pxa255timrPrvSync(Pxa255timr* timr){
+
+	UInt32 ticks = (*timr->cycles - timr->synced) >> PXA255_TIMR_TICK_SHIFT;
+	UInt32 old = timr->OSCR;
+	UInt8 i;
+
+	if(!ticks) return;
+
+	timr->synced += ticks << PXA255_TIMR_TICK_SHIFT;
+	timr->OSCR += ticks;
+
+	for(i = 0; i < 4; i++){
+
+		if(timr->OSMR[i] - old - 1 < ticks) timr->OSSR |= 1UL << i;	//OSCR went past this match value
+	}
+}
+
+static void pxa255timrPrvSchedule(Pxa255timr* timr){
+
+	UInt32 ticks = PXA255_TIMR_MAX_WAIT, t;
+	UInt8 i;
+
+	for(i = 0; i < 4; i++){
+
+		if(!(timr->OIER & (1UL << i))) continue;	//disabled matches still set OSSR, but nobody needs to be woken for them
+
+		t = timr->OSMR[i] - timr->OSCR;
+		if(t && t < ticks) ticks = t;
+	}
+
+	timr->due = timr->synced + (ticks << PXA255_TIMR_TICK_SHIFT);
+}
+
+static Boolean pxa255timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+
+	Pxa255timr* timr = userData;
+	UInt32 val = 0;
+
+	if(size != 4) {
+		err_str(__FILE__ ": Unexpected ");
+	//	err_str(write ? "write" : "read");
+	//	err_str(" of ");
+	//	err_dec(size);
+	//	err_str(" bytes to 0x");
+	//	err_hex(pa);
+	//	err_str("\r\n");
+		return true;		//we do not support non-word accesses
+	}
+
+	pa = (pa - PXA255_TIMR_BASE) >> 2;
+
+	pxa255timrPrvSync(timr);
+
+	if(write){
+		val = *(UInt32*)buf;
+		switch(pa){
+
+			case 0:
+			case 1:
+			case 2:
+			case 3:
+				timr->OSMR[pa] = val;
+				break;
+
+			case 4:
+				timr->OSCR = val;
+				break;
+
+			case 5:
+				timr->OSSR &=~ val;	//write 1 to clear
+				break;
+
+			case 6:
+				timr->OWER = val;
+				break;
+
+			case 7:
+				timr->OIER = val;
+				break;
+		}
+		pxa255timrPrvSchedule(timr);
+	}
+	else{
+		switch(pa){
+
+			case 0:
+			case 1:
+			case 2:
+			case 3:
+				val = timr->OSMR[pa];
+				break;
+
+			case 4:
+				val = timr->OSCR;
+				break;
+
+			case 5:
+				val = timr->OSSR;
+				break;
+
+			case 6:
+				val = timr->OWER;
+				break;
+
+			case 7:
+				val = timr->OIER;
+				break;
+		}
+		*(UInt32*)buf = val;
+	}
+	pxa255timrPrvRaiseLowerInts(timr);
+
+	return true;
+}
+
+Boolean pxa255timrInit(Pxa255timr* timr, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles){
+
+	__mem_zero(timr, sizeof(Pxa255timr));
+	timr->ic = ic;
+	timr->cycles = cycles;
+	timr->synced = *cycles;
+	pxa255timrPrvSchedule(timr);
+
+	return memRegionAdd(physMem, PXA255_TIMR_BASE, PXA255_TIMR_SIZE, pxa255timrPrvMemAccessF, timr);
+}
+
+void pxa255timrUpdate(Pxa255timr* timr){
+
+	pxa255timrPrvSync(timr);
+	pxa255timrPrvRaiseLowerInts(timr);
+	pxa255timrPrvSchedule(timr);
+}
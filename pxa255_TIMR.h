@@ -0,0 +1,45 @@
+#ifndef _PXA255_TIMR_H_
+#define _PXA255_TIMR_H_
+
+#include "mem.h"
+#include "cpu.h"
+#include "pxa255_IC.h"
+
+/*
+	PXA255 OS timers
+
+	PURRPOSE: timer tick for the kernel
+
+	OSCR is not ticked, it is worked out from the SoC's cycle counter when somebody looks at it.
+	"due" is the cycle count of the next enabled match, the SoC calls pxa255timrUpdate() when it
+	gets there (or skips straight to it when the guest is idle).
+
+	watchdog reset (OWER) is not modeled
+*/
+
+#define PXA255_TIMR_BASE	0x40A00000UL
+#define PXA255_TIMR_SIZE	0x00010000UL
+
+#define PXA255_TIMR_TICK_SHIFT	3		//OSCR counts once every 8 cpu cycles
+
+typedef struct{
+
+	Pxa255ic* ic;
+	const UInt32* cycles;	//SoC's cycle counter
+
+	UInt32 synced;		//cycle count OSCR is current as of (whole ticks only)
+	UInt32 due;		//cycle count at which the next enabled match happens
+
+	UInt32 OSMR[4];		//Match Register 0-3
+	UInt32 OIER;		//Interrupt Enable
+	UInt32 OWER;		//Watchdog enable
+	UInt32 OSCR;		//Counter Register
+	UInt32 OSSR;		//Status Register
+
+}Pxa255timr;
+
+Boolean pxa255timrInit(Pxa255timr* timr, ArmMem* physMem, Pxa255ic* ic, const UInt32* cycles);
+void pxa255timrUpdate(Pxa255timr* timr);	//bring OSCR up to date, raise any matches it passed and find the next one
+
+#endif
+
@@ -1,5 +1,6 @@
 #include "pxa255_UART.h"
 #include "mem.h"
+#include "math64.h"
 
 
 
@@ -74,6 +75,11 @@
 
 
 static void pxa255uartPrvRecalc(Pxa255uart* uart);
+#ifdef EMBEDDED
+	#define pxa255uartPrvRecalcRate(uart)	//no baud model, chars move at host speed
+#else
+	static void pxa255uartPrvRecalcRate(Pxa255uart* uart);
+#endif
 
 
 static void pxa255uartPrvIrq(Pxa255uart* uart, Boolean raise){
@@ -244,6 +250,7 @@ static Boolean pxa255uartPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Bo
 			case 0:
 				if(DLAB){				//if DLAB - set "baudrate"...
 					uart->DLL = val;
+					pxa255uartPrvRecalcRate(uart);
 					recalcValues = false;
 				}
 				else{
@@ -256,16 +263,11 @@ static Boolean pxa255uartPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Bo
 				if(DLAB){
 					
 					uart->DLH = val;
+					pxa255uartPrvRecalcRate(uart);
 					recalcValues = false;
 				}
 				else{
 					t = uart->IER ^ val;
-				
-					if(t & UART_IER_DMAE){
-						
-						err_str("pxa255UART: DMA mode cannot be enabled");
-						t &=~ UART_IER_DMAE;	//undo the change
-					}
 					
 					if(t & UART_IER_UUE){
 						
@@ -319,6 +321,7 @@ static Boolean pxa255uartPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Bo
 					}
 				}
 				uart->LCR = val;
+				pxa255uartPrvRecalcRate(uart);
 				break;
 			
 			case 4:
@@ -429,68 +432,137 @@ Boolean pxa255uartInit(Pxa255uart* uart, ArmMem* physMem, Pxa255ic* ic, UInt32 b
 	return memRegionAdd(physMem, baseAddr, PXA255_UART_SIZE, pxa255uartPrvMemAccessF, uart);
 }
 
-void pxa255uartProcess(Pxa255uart* uart){		//send and rceive up to one character
+static Boolean pxa255uartPrvTx(Pxa255uart* uart){	//shift out one char, false if there was none
 	
 	UInt8 t;
-	UInt16 v;
 	
-	//first process sending (if any)
-	if(!(uart->LSR & UART_LSR_TEMT)){
+	if(uart->LSR & UART_LSR_TEMT) return false;
+	
+	pxa255uartPrvPutchar(uart, uart->transmitShift);
+	
+	if(uart->FCR & UART_FCR_TRFIFOE){	//fifo mode
 		
-		pxa255uartPrvPutchar(uart, uart->transmitShift);
+		t = pxa255uartPrvFifoUsed(&uart->TX);
 		
-		if(uart->FCR & UART_FCR_TRFIFOE){	//fifo mode
-			
-			t = pxa255uartPrvFifoUsed(&uart->TX);
-			
-			if(t--){
-				
-				uart->transmitShift = pxa255uartPrvFifoGet(&uart->TX);
-				if(t <= UART_FIFO_DEPTH / 2) uart->LSR |= UART_LSR_TDRQ;	//above half full - clear TDRQ bit
-			}
-			else{
-				
-				uart->LSR |= UART_LSR_TEMT;
-			}
-		}
-		else if (uart->LSR & UART_LSR_TDRQ){
+		if(t--){
 			
-			uart->LSR |= UART_LSR_TEMT;
+			uart->transmitShift = pxa255uartPrvFifoGet(&uart->TX);
+			if(t <= UART_FIFO_DEPTH / 2) uart->LSR |= UART_LSR_TDRQ;	//above half full - clear TDRQ bit
 		}
 		else{
 			
-			uart->transmitShift = uart->transmitHolding;
-			uart->LSR |= UART_LSR_TDRQ;
+			uart->LSR |= UART_LSR_TEMT;
 		}
 	}
-	
-	//now process receiving
-	v = pxa255uartPrvGetchar(uart);
-	if(v != UART_CHAR_NONE){
+	else if (uart->LSR & UART_LSR_TDRQ){
 		
-		uart->cyclesSinceRecv = 0;
-		uart->LSR |= UART_LSR_DR;
+		uart->LSR |= UART_LSR_TEMT;
+	}
+	else{
 		
-		if(uart->FCR & UART_FCR_TRFIFOE){	//fifo mode
+		uart->transmitShift = uart->transmitHolding;
+		uart->LSR |= UART_LSR_TDRQ;
+	}
+	
+	return true;
+}
+
+static Boolean pxa255uartPrvRx(Pxa255uart* uart){	//take in one char, false if there was none or no room
+	
+	UInt16 v;
+	
+	if(uart->FCR & UART_FCR_TRFIFOE){	//leave the rest with the host till the guest makes room
 		
-			if(!pxa255uartPrvFifoPut(&uart->RX, v)){
-				
-				uart->LSR |= UART_LSR_OE;	
-			}
-		}
-		else{
+		if(pxa255uartPrvFifoUsed(&uart->RX) == UART_FIFO_DEPTH) return false;
+	}
+	else if(uart->LSR & UART_LSR_DR) return false;
+	
+	v = pxa255uartPrvGetchar(uart);
+	if(v == UART_CHAR_NONE) return false;
+	
+	uart->cyclesSinceRecv = 0;
+	
+	if(uart->FCR & UART_FCR_TRFIFOE){	//fifo mode
+	
+		if(!pxa255uartPrvFifoPut(&uart->RX, v)){
 			
-			if(uart->LSR & UART_LSR_DR) uart->LSR |= UART_LSR_OE;
-			else uart->receiveHolding = v;
+			uart->LSR |= UART_LSR_OE;	
 		}
 	}
-	else if(uart->cyclesSinceRecv <= 4){
+	else{
+		
+		if(uart->LSR & UART_LSR_DR) uart->LSR |= UART_LSR_OE;
+		else uart->receiveHolding = v;
+	}
+	uart->LSR |= UART_LSR_DR;
+	
+	return true;
+}
+
+void pxa255uartProcessCycles(Pxa255uart* uart, _UNUSED_ UInt32 cycles){
+	
+	UInt32 i, n = 0xFFFFFFFFUL;
+	Boolean rcvd = false;
+	
+#ifndef EMBEDDED
+	if(uart->cyclesPerChar){	//character times that passed; any not used by a char are gone, as on an idle line
+		
+		uart->credit += cycles;
+		n = uart->credit / uart->cyclesPerChar;
+		uart->credit -= n * uart->cyclesPerChar;
+		if(!n) return;
+	}
+#endif
+	
+	for(i = n; i && pxa255uartPrvTx(uart); i--);
+	for(i = n; i && pxa255uartPrvRx(uart); i--) rcvd = true;
+	
+	if(!rcvd && uart->cyclesSinceRecv <= 4){	//rx timeout is counted in (at least) character times
 		uart->cyclesSinceRecv++;
 	}
 	
 	pxa255uartPrvRecalc(uart);
 }
 
+#ifndef EMBEDDED
+
+static void pxa255uartPrvRecalcRate(Pxa255uart* uart){
+	
+	UInt32 div = (((UInt32)uart->DLH) << 8) | uart->DLL;
+	UInt8 bits = 7 + (uart->LCR & UART_LCR_WLS_MASK);	//start + 5..8 data + stop
+	
+	if(uart->LCR & UART_LCR_PEN) bits++;
+	if(uart->LCR & UART_LCR_STB) bits++;
+	if(!div) div = 1;
+	
+	uart->cyclesPerChar = ((UInt64)uart->cyclesPerSec * (div * bits)) / PXA255_UART_BAUD_BASE;
+	if(uart->cyclesPerSec && !uart->cyclesPerChar) uart->cyclesPerChar = 1;
+}
+
+void pxa255uartSetRate(Pxa255uart* uart, UInt32 cyclesPerSec){
+	
+	uart->cyclesPerSec = cyclesPerSec;
+	uart->credit = 0;
+	pxa255uartPrvRecalcRate(uart);
+}
+
+#endif
+
+Boolean pxa255uartDmaTxReq(void* userData){
+	
+	Pxa255uart* uart = userData;
+	
+	return (uart->IER & (UART_IER_DMAE | UART_IER_UUE)) == (UART_IER_DMAE | UART_IER_UUE) && (uart->FCR & UART_FCR_TRFIFOE) && (uart->LSR & UART_LSR_TDRQ);
+}
+
+Boolean pxa255uartDmaRxReq(void* userData){
+	
+	static const UInt8 trigger[] = {1, 8, 16, 32};
+	Pxa255uart* uart = userData;
+	
+	return (uart->IER & (UART_IER_DMAE | UART_IER_UUE)) == (UART_IER_DMAE | UART_IER_UUE) && (uart->FCR & UART_FCR_TRFIFOE) && pxa255uartPrvFifoUsed(&uart->RX) >= trigger[uart->FCR >> 6];
+}
+
 static void pxa255uartPrvRecalcCharBits(Pxa255uart* uart, UInt16 c){
 	
 	if(c & UART_CHAR_BREAK) uart->LSR |= UART_LSR_BI;
@@ -75,12 +75,24 @@ typedef struct{
 	UInt8 DLH;		//divior latch high;
 	UInt8 ISR;		//infrared selection register
 	
-	
+#ifndef EMBEDDED
+	UInt32 cyclesPerSec;	//virtual baud rate model, 0 = run at host speed
+	UInt32 cyclesPerChar;
+	UInt32 credit;		//cycles not yet spent on characters
+#endif
 	
 }Pxa255uart;
 
+#define PXA255_UART_BAUD_BASE	921600UL	//14.7456MHz / 16, baud = this / divisor
+
 Boolean pxa255uartInit(Pxa255uart* uart, ArmMem* physMem, Pxa255ic* ic, UInt32 baseAddr, UInt8 irq);
-void pxa255uartProcess(Pxa255uart* uart);		//write out data in TX fifo and read data into RX fifo
+void pxa255uartProcessCycles(Pxa255uart* uart, UInt32 cycles);	//move as many chars as "cycles" allow at the programmed baud rate (all of them at host speed)
+#ifndef EMBEDDED
+	void pxa255uartSetRate(Pxa255uart* uart, UInt32 cyclesPerSec);	//cpu cycles per virtual second for the baud model, 0 to disable it
+#endif
+
+Boolean pxa255uartDmaTxReq(void* userData);	//Pxa255dmaReqF: TX fifo is at least half empty
+Boolean pxa255uartDmaRxReq(void* userData);	//Pxa255dmaReqF: RX fifo reached its trigger level
 
 void pxa255uartSetFuncs(Pxa255uart* uart, Pxa255UartReadF readF, Pxa255UartWriteF writeF, void* userData);
 
@@ -0,0 +1,86 @@
+#include "spiRam.h"
+
+
+static void spiRamPrvCmd(SpiRam* ram, UInt8 chip, UInt8 cmd, UInt32 adr){
+
+	ram->selF(ram->userData, chip, true);
+	ram->xferF(ram->userData, cmd);
+	ram->xferF(ram->userData, adr >> 16);
+	ram->xferF(ram->userData, adr >> 8);
+	ram->xferF(ram->userData, adr);
+	if(cmd == SPI_RAM_CMD_FAST_READ) ram->xferF(ram->userData, 0xFF);
+}
+
+void spiRamInit(SpiRam* ram, UInt8 type, UInt8 numChips, Boolean fastRead, SpiRamXferF xferF, SpiRamSelectF selF, void* userData){
+
+	UInt8 i;
+
+	ram->xferF = xferF;
+	ram->selF = selF;
+	ram->userData = userData;
+	ram->numChips = numChips;
+	ram->readCmd = fastRead ? SPI_RAM_CMD_FAST_READ : SPI_RAM_CMD_READ;
+
+	if(type == SPI_RAM_APS6404){
+
+		ram->chipSz = 0x00800000UL;
+		ram->pageSz = 1024;
+	}
+	else{
+
+		ram->chipSz = 0x00020000UL;
+		ram->pageSz = 0;
+	}
+
+	for(i = 0; i < numChips; i++){
+
+		if(type == SPI_RAM_APS6404){
+
+			selF(userData, i, true);
+			xferF(userData, SPI_RAM_CMD_RST_EN);
+			selF(userData, i, false);
+			selF(userData, i, true);
+			xferF(userData, SPI_RAM_CMD_RST);
+			selF(userData, i, false);
+		}
+		else{
+
+			selF(userData, i, true);
+			xferF(userData, SPI_RAM_CMD_WRMR);
+			xferF(userData, SPI_RAM_MODE_SEQ);
+			selF(userData, i, false);
+		}
+	}
+}
+
+UInt32 spiRamSize(SpiRam* ram){
+
+	return ram->chipSz * ram->numChips;
+}
+
+Boolean spiRamAccess(void* userData, UInt32 ofst, UInt8 size, Boolean write, void* bufP){
+
+	SpiRam* ram = userData;
+	UInt8* buf = bufP;
+	UInt32 adr, lim;
+	UInt8 chip, n;
+
+	while(size){
+
+		chip = ofst / ram->chipSz;
+		if(chip >= ram->numChips) return false;
+		adr = ofst % ram->chipSz;
+
+		lim = ram->pageSz ? ram->pageSz - (adr % ram->pageSz) : ram->chipSz - adr;
+		n = lim < size ? lim : size;
+
+		spiRamPrvCmd(ram, chip, write ? SPI_RAM_CMD_WRITE : ram->readCmd, adr);
+		ofst += n;
+		size -= n;
+		if(write) while(n--) ram->xferF(ram->userData, *buf++);
+		else while(n--) *buf++ = ram->xferF(ram->userData, 0xFF);
+		ram->selF(ram->userData, chip, false);
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef _SPI_RAM_H_
+#define _SPI_RAM_H_
+
+#include "types.h"
+
+/*
+	Serial SRAM/PSRAM as guest RAM (23LC1024, APS6404 and friends).
+
+	Chips are stacked back to back, each on its own chip select, and share the
+	bus through the xfer callback. Every access is one READ/WRITE command with
+	a 24-bit address followed by a sequential burst, so an icache line fill
+	costs one command. Bursts are split at chip and wrap-page boundaries.
+*/
+
+#define SPI_RAM_23LC1024	0	//128KB, 20MHz, sequential mode set at init
+#define SPI_RAM_APS6404		1	//8MB, bursts wrap at 1KB pages, fast read above 33MHz
+
+#define SPI_RAM_CMD_WRMR	0x01	//23LC1024 mode register
+#define SPI_RAM_CMD_WRITE	0x02
+#define SPI_RAM_CMD_READ	0x03
+#define SPI_RAM_CMD_RDMR	0x05	//23LC1024 mode register
+#define SPI_RAM_CMD_FAST_READ	0x0B	//one dummy byte after the address
+#define SPI_RAM_CMD_RST_EN	0x66	//APS6404
+#define SPI_RAM_CMD_RST		0x99	//APS6404
+#define SPI_RAM_CMD_READ_ID	0x9F	//APS6404
+
+#define SPI_RAM_MODE_SEQ	0x40	//23LC1024 sequential mode
+
+typedef UInt8 (*SpiRamXferF)(void* userData, UInt8 byte);
+typedef void (*SpiRamSelectF)(void* userData, UInt8 chip, Boolean selected);
+
+typedef struct{
+
+	SpiRamXferF xferF;
+	SpiRamSelectF selF;
+	void* userData;
+
+	UInt32 chipSz;
+	UInt16 pageSz;		//bursts may not cross this, 0 = only chip boundaries matter
+	UInt8 numChips;
+	UInt8 readCmd;
+
+}SpiRam;
+
+void spiRamInit(SpiRam* ram, UInt8 type, UInt8 numChips, Boolean fastRead, SpiRamXferF xferF, SpiRamSelectF selF, void* userData);
+UInt32 spiRamSize(SpiRam* ram);
+Boolean spiRamAccess(void* userData, UInt32 ofst, UInt8 size, Boolean write, void* buf);	//RamCallout.accessF
+
+#endif
@@ -0,0 +1,177 @@
+#include "spiRamSim.h"
+#include "rt.h"
+
+#define STATE_CMD	0
+#define STATE_ADR	1	//+0..2
+#define STATE_DUMMY	4
+#define STATE_DATA	5
+#define STATE_WRMR	6
+#define STATE_RDMR	7
+#define STATE_ID	8
+#define STATE_DONE	9	//ignore everything until deselected
+
+#define MODE_BYTE	0x00	//23LC1024 modes
+#define MODE_PAGE	0x80
+
+
+Boolean spiRamSimInit(SpiRamSim* sim, UInt8 type, UInt8 numChips){
+
+	UInt8 i;
+
+	if(numChips > SPI_RAM_SIM_MAX_CHIPS) return false;
+
+	sim->chipSz = type == SPI_RAM_APS6404 ? 0x00800000UL : 0x00020000UL;
+	sim->pageSz = type == SPI_RAM_APS6404 ? 1024 : 0;
+	sim->numChips = numChips;
+	sim->sel = -1;
+	sim->numCmds = 0;
+	sim->numBytes = 0;
+
+	for(i = 0; i < numChips; i++){
+
+		sim->chips[i].mem = emu_alloc(sim->chipSz);
+		if(!sim->chips[i].mem) return false;
+		sim->chips[i].state = STATE_CMD;
+		sim->chips[i].mode = SPI_RAM_MODE_SEQ;
+	}
+
+	return true;
+}
+
+void spiRamSimSelect(void* userData, UInt8 chip, Boolean selected){
+
+	SpiRamSim* sim = userData;
+
+	if(chip >= sim->numChips){
+
+		err_str("spiRamSim: no such chip\r\n");
+		return;
+	}
+
+	if(selected){
+
+		if(sim->sel >= 0) err_str("spiRamSim: two chips selected\r\n");
+		sim->sel = chip;
+		sim->chips[chip].state = STATE_CMD;
+	}
+	else{
+
+		if(sim->sel == chip) sim->sel = -1;
+		if(sim->chips[chip].state > STATE_CMD && sim->chips[chip].state < STATE_DATA) err_str("spiRamSim: deselected mid-command\r\n");
+	}
+}
+
+static void spiRamSimPrvNextAdr(SpiRamSim* sim, SpiRamSimChip* c){
+
+	UInt32 wrap = sim->chipSz;
+
+	if(sim->pageSz) wrap = sim->pageSz;
+	else if(c->mode == MODE_PAGE) wrap = 32;
+	else if(c->mode == MODE_BYTE){
+
+		c->state = STATE_DONE;
+		return;
+	}
+
+	if(!((c->adr + 1) & (wrap - 1))) c->wrapped = true;	//only an error if another byte follows
+	c->adr = (c->adr & ~(wrap - 1)) | ((c->adr + 1) & (wrap - 1));
+}
+
+UInt8 spiRamSimXfer(void* userData, UInt8 byte){
+
+	SpiRamSim* sim = userData;
+	SpiRamSimChip* c;
+	UInt8 ret = 0xFF;
+
+	if(sim->sel < 0) return 0xFF;		//nobody drives MISO
+	c = sim->chips + sim->sel;
+	sim->numBytes++;
+
+	switch(c->state){
+
+		case STATE_CMD:
+
+			sim->numCmds++;
+			c->cmd = byte;
+			c->adr = 0;
+			c->wrapped = false;
+			switch(byte){
+
+				case SPI_RAM_CMD_READ:
+				case SPI_RAM_CMD_FAST_READ:
+				case SPI_RAM_CMD_WRITE:
+					c->state = STATE_ADR;
+					break;
+
+				case SPI_RAM_CMD_WRMR:
+					c->state = sim->pageSz ? STATE_DONE : STATE_WRMR;
+					break;
+
+				case SPI_RAM_CMD_RDMR:
+					c->state = sim->pageSz ? STATE_DONE : STATE_RDMR;
+					break;
+
+				case SPI_RAM_CMD_READ_ID:
+					c->state = sim->pageSz ? STATE_ADR : STATE_DONE;
+					break;
+
+				default:	//reset and friends
+					c->state = STATE_DONE;
+					break;
+			}
+			break;
+
+		case STATE_ADR + 0:
+		case STATE_ADR + 1:
+		case STATE_ADR + 2:
+
+			c->adr = (c->adr << 8) | byte;
+			if(c->state++ != STATE_ADR + 2) break;
+
+			c->adr &= sim->chipSz - 1;
+			if(c->cmd == SPI_RAM_CMD_READ_ID){
+
+				c->adr = 0;
+				c->state = STATE_ID;
+			}
+			else if(c->cmd == SPI_RAM_CMD_FAST_READ) c->state = STATE_DUMMY;
+			else c->state = STATE_DATA;
+			break;
+
+		case STATE_DUMMY:
+
+			c->state = STATE_DATA;
+			break;
+
+		case STATE_DATA:
+
+			if(c->wrapped){
+
+				err_str("spiRamSim: burst wrapped\r\n");
+				c->wrapped = false;
+			}
+			if(c->cmd == SPI_RAM_CMD_WRITE) c->mem[c->adr] = byte;
+			else ret = c->mem[c->adr];
+			spiRamSimPrvNextAdr(sim, c);
+			break;
+
+		case STATE_WRMR:
+
+			c->mode = byte & 0xC0;
+			c->state = STATE_DONE;
+			break;
+
+		case STATE_RDMR:
+
+			ret = c->mode;
+			break;
+
+		case STATE_ID:		//MFID, KGD, then EID
+
+			ret = c->adr == 0 ? 0x0D : (c->adr == 1 ? 0x5D : 0x40);
+			c->adr++;
+			break;
+	}
+
+	return ret;
+}
@@ -0,0 +1,45 @@
+#ifndef _SPI_RAM_SIM_H_
+#define _SPI_RAM_SIM_H_
+
+#include "types.h"
+#include "spiRam.h"
+
+/*
+	Host-side model of the SPI RAM chips spiRam.c drives, at the level of
+	bytes on the bus. Use it as the xfer/select callbacks to run callout RAM
+	through the real driver on a PC build. Protocol misuse (data before a
+	full address, two chips selected, bursts crossing a wrap page) is
+	reported through err_str since it would corrupt data on real parts.
+*/
+
+#define SPI_RAM_SIM_MAX_CHIPS	4
+
+typedef struct{
+
+	UInt8* mem;
+	UInt32 adr;
+	UInt8 state;
+	UInt8 cmd;
+	UInt8 mode;
+	Boolean wrapped;
+
+}SpiRamSimChip;
+
+typedef struct{
+
+	SpiRamSimChip chips[SPI_RAM_SIM_MAX_CHIPS];
+	UInt32 chipSz;
+	UInt16 pageSz;
+	UInt8 numChips;
+	Int8 sel;		//selected chip, -1 if none
+
+	UInt32 numCmds;		//stats
+	UInt32 numBytes;
+
+}SpiRamSim;
+
+Boolean spiRamSimInit(SpiRamSim* sim, UInt8 type, UInt8 numChips);
+UInt8 spiRamSimXfer(void* userData, UInt8 byte);
+void spiRamSimSelect(void* userData, UInt8 chip, Boolean selected);
+
+#endif
@@ -0,0 +1,568 @@
+#include "vfp.h"
+#include "math64.h"
+#include <fenv.h>
+#include <math.h>
+
+
+#define VFP_FPSID		0x410120B4UL	//VFP11 (VFPv2)
+
+#define VFP_FPEXC_EN		0x40000000UL
+
+#define VFP_FPSCR_NZCV		0xF0000000UL
+#define VFP_FPSCR_DN		0x02000000UL	//default NaN
+#define VFP_FPSCR_FZ		0x01000000UL	//flush to zero
+#define VFP_FPSCR_RMODE_SHIFT	22
+#define VFP_FPSCR_STRIDE_SHIFT	20
+#define VFP_FPSCR_LEN_SHIFT	16
+#define VFP_FPSCR_IDC		0x00000080UL	//cumulative flags: input denormal
+#define VFP_FPSCR_IXC		0x00000010UL	//inexact
+#define VFP_FPSCR_UFC		0x00000008UL	//underflow
+#define VFP_FPSCR_OFC		0x00000004UL	//overflow
+#define VFP_FPSCR_DZC		0x00000002UL	//divide by zero
+#define VFP_FPSCR_IOC		0x00000001UL	//invalid
+#define VFP_FPSCR_MASK		0xF3F79F9FUL	//bits that exist
+
+#define VFP_REG_FPSID		0	//FMRX/FMXR register numbers
+#define VFP_REG_FPSCR		1
+#define VFP_REG_FPEXC		8
+
+#define VFP_OP_MAC		0	//CDP opcodes (p:q:r:s)
+#define VFP_OP_NMAC		1
+#define VFP_OP_MSC		2
+#define VFP_OP_NMSC		3
+#define VFP_OP_MUL		4
+#define VFP_OP_NMUL		5
+#define VFP_OP_ADD		6
+#define VFP_OP_SUB		7
+#define VFP_OP_DIV		8
+#define VFP_OP_EXT		15	//Fn:N says which
+#define VFP_OP_SQRT		16	//not an encoding, for vfpPrvCalc()
+
+#define VFP_EXT_CPY		0x00
+#define VFP_EXT_ABS		0x01
+#define VFP_EXT_NEG		0x02
+#define VFP_EXT_SQRT		0x03
+#define VFP_EXT_CMP		0x08
+#define VFP_EXT_CMPE		0x09
+#define VFP_EXT_CMPZ		0x0A
+#define VFP_EXT_CMPEZ		0x0B
+#define VFP_EXT_CVT		0x0F	//FCVTDS on cp10, FCVTSD on cp11
+#define VFP_EXT_UITO		0x10
+#define VFP_EXT_SITO		0x11
+#define VFP_EXT_TOUI		0x18
+#define VFP_EXT_TOUIZ		0x19
+#define VFP_EXT_TOSI		0x1A
+#define VFP_EXT_TOSIZ		0x1B
+
+#define VFP_S_SIGN		0x80000000UL
+#define VFP_S_EXP		0x7F800000UL
+#define VFP_S_FRAC		0x007FFFFFUL
+#define VFP_S_QUIET		0x00400000UL
+#define VFP_D_SIGN		0x8000000000000000ULL
+#define VFP_D_EXP		0x7FF0000000000000ULL
+#define VFP_D_FRAC		0x000FFFFFFFFFFFFFULL
+#define VFP_D_QUIET		0x0008000000000000ULL
+
+
+static const int vfpPrvRound[4] = {FE_TONEAREST, FE_UPWARD, FE_DOWNWARD, FE_TOWARDZERO};	//by FPSCR RMode
+
+
+static UInt64 vfpPrvGet(ArmVfp* vfp, UInt8 r, Boolean dbl){		//r is a d number if dbl
+
+	return dbl ? u64_from_halves(vfp->s[r * 2 + 1], vfp->s[r * 2]) : vfp->s[r];
+}
+
+static void vfpPrvSet(ArmVfp* vfp, UInt8 r, Boolean dbl, UInt64 v){
+
+	if(dbl){
+		vfp->s[r * 2] = u64_64_to_32(v);
+		vfp->s[r * 2 + 1] = u64_get_hi(v);
+	}
+	else vfp->s[r] = v;
+}
+
+static _INLINE_ UInt64 vfpPrvSign(Boolean dbl){
+
+	return dbl ? VFP_D_SIGN : VFP_S_SIGN;
+}
+
+static _INLINE_ Boolean vfpPrvIsNan(UInt64 v, Boolean dbl){
+
+	return dbl ? (v &~ VFP_D_SIGN) > VFP_D_EXP : (v & ~VFP_S_SIGN) > VFP_S_EXP;
+}
+
+static _INLINE_ Boolean vfpPrvIsSnan(UInt64 v, Boolean dbl){
+
+	return vfpPrvIsNan(v, dbl) && !(v & (dbl ? VFP_D_QUIET : VFP_S_QUIET));
+}
+
+static _INLINE_ Boolean vfpPrvIsDenormal(UInt64 v, Boolean dbl){
+
+	return dbl ? !(v & VFP_D_EXP) && (v & VFP_D_FRAC) : !(v & VFP_S_EXP) && (v & VFP_S_FRAC);
+}
+
+static UInt32 vfpPrvHostFlags(void){		//host's exception flags as FPSCR bits
+
+	int f = fetestexcept(FE_ALL_EXCEPT);
+	UInt32 ret = 0;
+
+	if(!f) return 0;
+	if(f & FE_INVALID) ret |= VFP_FPSCR_IOC;
+	if(f & FE_DIVBYZERO) ret |= VFP_FPSCR_DZC;
+	if(f & FE_OVERFLOW) ret |= VFP_FPSCR_OFC;
+	if(f & FE_UNDERFLOW) ret |= VFP_FPSCR_UFC;
+	if(f & FE_INEXACT) ret |= VFP_FPSCR_IXC;
+	return ret;
+}
+
+static UInt64 vfpPrvNan(ArmVfp* vfp, UInt64 a, UInt64 b, Boolean dbl){	//result of an op on a and b, one or both NaN: first signalling one, else first quiet one
+
+	UInt64 ret;
+
+	if(vfpPrvIsSnan(a, dbl)) ret = a;
+	else if(vfpPrvIsSnan(b, dbl)) ret = b;
+	else ret = vfpPrvIsNan(a, dbl) ? a : b;
+
+	if(vfpPrvIsSnan(ret, dbl)) vfp->FPSCR |= VFP_FPSCR_IOC;
+	if(vfp->FPSCR & VFP_FPSCR_DN) return dbl ? (VFP_D_EXP | VFP_D_QUIET) : (VFP_S_EXP | VFP_S_QUIET);
+	return ret | (dbl ? VFP_D_QUIET : VFP_S_QUIET);
+}
+
+static double vfpPrvToHost(ArmVfp* vfp, UInt64 v, Boolean dbl){		//v is not a NaN
+
+	union{ UInt64 u; double d; } d;
+	union{ UInt32 u; float f; } s;
+
+	if((vfp->FPSCR & VFP_FPSCR_FZ) && vfpPrvIsDenormal(v, dbl)){
+
+		vfp->FPSCR |= VFP_FPSCR_IDC;
+		v &= vfpPrvSign(dbl);
+	}
+	if(dbl){
+		d.u = v;
+		return d.d;
+	}
+	s.u = v;
+	return s.f;
+}
+
+static UInt64 vfpPrvFromHost(ArmVfp* vfp, double r, Boolean dbl){	//r came from non-NaN operands, rounded here for singles
+
+	union{ UInt64 u; double d; } d;
+	union{ UInt32 u; float f; } s;
+	volatile float f;
+	UInt64 v;
+
+	if(dbl){
+		d.d = r;
+		v = d.u;
+	}
+	else{
+		f = r;
+		s.f = f;
+		v = s.u;
+	}
+
+	if(vfpPrvIsNan(v, dbl)) v = dbl ? (VFP_D_EXP | VFP_D_QUIET) : (VFP_S_EXP | VFP_S_QUIET);	//an invalid op, the host's NaN is not ARM's default one
+	else if((vfp->FPSCR & VFP_FPSCR_FZ) && vfpPrvIsDenormal(v, dbl)){
+
+		feclearexcept(FE_UNDERFLOW | FE_INEXACT);	//flushed results only say underflow. earlier ones are in FPSCR already
+		vfp->FPSCR |= VFP_FPSCR_UFC;
+		v &= vfpPrvSign(dbl);
+	}
+	vfp->FPSCR |= vfpPrvHostFlags();
+	return v;
+}
+
+static UInt64 vfpPrvCalc(ArmVfp* vfp, UInt8 op, UInt64 a, UInt64 b, Boolean dbl){	//a op b on the host, b is ignored for sqrt
+
+	volatile double x, y, r;
+
+	if(vfpPrvIsNan(a, dbl) || (op != VFP_OP_SQRT && vfpPrvIsNan(b, dbl))) return vfpPrvNan(vfp, a, op == VFP_OP_SQRT ? a : b, dbl);
+
+	x = vfpPrvToHost(vfp, a, dbl);
+	y = op == VFP_OP_SQRT ? 0 : vfpPrvToHost(vfp, b, dbl);
+
+	switch(op){
+
+		case VFP_OP_MUL:
+			r = x * y;
+			break;
+
+		case VFP_OP_ADD:
+			r = x + y;
+			break;
+
+		case VFP_OP_SUB:
+			r = x - y;
+			break;
+
+		case VFP_OP_DIV:
+			r = x / y;
+			break;
+
+		default:
+			r = sqrt(x);
+			break;
+	}
+	return vfpPrvFromHost(vfp, r, dbl);
+}
+
+static void vfpPrvCompare(ArmVfp* vfp, UInt64 a, UInt64 b, Boolean dbl, Boolean E){	//FCMP(E), E makes quiet NaNs invalid too
+
+	UInt32 nzcv;
+	double x, y;
+
+	if(vfpPrvIsNan(a, dbl) || vfpPrvIsNan(b, dbl)){
+
+		if(E || vfpPrvIsSnan(a, dbl) || vfpPrvIsSnan(b, dbl)) vfp->FPSCR |= VFP_FPSCR_IOC;
+		nzcv = 0x3;		//unordered
+	}
+	else{
+
+		x = vfpPrvToHost(vfp, a, dbl);
+		y = vfpPrvToHost(vfp, b, dbl);
+
+		if(x == y) nzcv = 0x6;
+		else if(x < y) nzcv = 0x8;
+		else nzcv = 0x2;
+	}
+	vfp->FPSCR = (vfp->FPSCR &~ VFP_FPSCR_NZCV) | (nzcv << 28);
+}
+
+static UInt32 vfpPrvToInt(ArmVfp* vfp, UInt64 a, Boolean dbl, Boolean sgnd, Boolean toZero){	//saturating, NaN gives 0
+
+	double x, t;
+
+	if(vfpPrvIsNan(a, dbl)){
+
+		vfp->FPSCR |= VFP_FPSCR_IOC;
+		return 0;
+	}
+
+	x = vfpPrvToHost(vfp, a, dbl);
+	t = toZero ? trunc(x) : nearbyint(x);		//nearbyint() goes by the rounding mode we set
+
+	if(sgnd ? t >= 2147483648.0 : t >= 4294967296.0){
+
+		vfp->FPSCR |= VFP_FPSCR_IOC;
+		return sgnd ? 0x7FFFFFFFUL : 0xFFFFFFFFUL;
+	}
+	if(sgnd ? t < -2147483648.0 : t < 0){
+
+		vfp->FPSCR |= VFP_FPSCR_IOC;
+		return sgnd ? 0x80000000UL : 0;
+	}
+	if(t != x) vfp->FPSCR |= VFP_FPSCR_IXC;
+
+	return sgnd ? (UInt32)(Int32)t : (UInt32)t;
+}
+
+static UInt64 vfpPrvConvert(ArmVfp* vfp, UInt64 a, Boolean toDbl){	//FCVTDS and FCVTSD
+
+	UInt64 ret;
+
+	if(!vfpPrvIsNan(a, !toDbl)) return vfpPrvFromHost(vfp, vfpPrvToHost(vfp, a, !toDbl), toDbl);
+
+	if(vfpPrvIsSnan(a, !toDbl)) vfp->FPSCR |= VFP_FPSCR_IOC;
+	if(vfp->FPSCR & VFP_FPSCR_DN) return toDbl ? (VFP_D_EXP | VFP_D_QUIET) : (VFP_S_EXP | VFP_S_QUIET);
+
+	if(toDbl) ret = (u64_shl(a & VFP_S_SIGN, 32)) | VFP_D_EXP | VFP_D_QUIET | u64_shl(a & VFP_S_FRAC, 29);
+	else ret = (u64_get_hi(a) & VFP_S_SIGN) | VFP_S_EXP | VFP_S_QUIET | (u64_64_to_32(u64_shr(a, 29)) & VFP_S_FRAC);
+
+	return ret;
+}
+
+static UInt64 vfpPrvElement(ArmVfp* vfp, UInt8 opc, UInt8 ext, UInt8 d, UInt8 n, UInt8 m, Boolean dbl){	//one element of a vectorizable op
+
+	UInt64 vd = vfpPrvGet(vfp, d, dbl), vn = vfpPrvGet(vfp, n, dbl), vm = vfpPrvGet(vfp, m, dbl), sign = vfpPrvSign(dbl), prod;
+
+	switch(opc){
+
+		case VFP_OP_MAC:	//Fd + Fn * Fm, product rounded first
+		case VFP_OP_NMAC:	//Fd - Fn * Fm
+		case VFP_OP_MSC:	//-Fd + Fn * Fm
+		case VFP_OP_NMSC:	//-Fd - Fn * Fm
+			prod = vfpPrvCalc(vfp, VFP_OP_MUL, vn, vm, dbl);
+			if(opc & 1) prod ^= sign;
+			if(opc & 2) vd ^= sign;
+			return vfpPrvCalc(vfp, VFP_OP_ADD, vd, prod, dbl);
+
+		case VFP_OP_MUL:
+		case VFP_OP_ADD:
+		case VFP_OP_SUB:
+		case VFP_OP_DIV:
+			return vfpPrvCalc(vfp, opc, vn, vm, dbl);
+
+		case VFP_OP_NMUL:
+			return vfpPrvCalc(vfp, VFP_OP_MUL, vn, vm, dbl) ^ sign;
+	}
+
+	switch(ext){
+
+		case VFP_EXT_CPY:
+			return vm;
+
+		case VFP_EXT_ABS:
+			return vm &~ sign;
+
+		case VFP_EXT_NEG:
+			return vm ^ sign;
+
+		default:		//VFP_EXT_SQRT
+			return vfpPrvCalc(vfp, VFP_OP_SQRT, vm, vm, dbl);
+	}
+}
+
+static Boolean vfpPrvExecute(ArmVfp* vfp, Boolean dbl, UInt8 op1, UInt8 CRd, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	UInt8 D = (op1 >> 2) & 1, N = (op2 >> 2) & 1, M = op2 & 1;
+	UInt8 opc = (op1 & 0x08) | ((op1 & 0x03) << 1) | ((op2 >> 1) & 1);
+	UInt8 ext = (CRn << 1) | N;
+	UInt8 d = dbl ? CRd : (CRd << 1) | D, n = dbl ? CRn : (CRn << 1) | N, m = dbl ? CRm : (CRm << 1) | M;
+	UInt8 len, stride, bank, i;
+	Boolean mVec;
+
+	if(opc == VFP_OP_EXT) switch(ext){		//the scalar-only ones, with their mixed register sizes, are done right here
+
+		case VFP_EXT_CMP:
+		case VFP_EXT_CMPE:
+		case VFP_EXT_CMPZ:
+		case VFP_EXT_CMPEZ:
+			if(dbl && (D || M)) return false;
+			vfpPrvCompare(vfp, vfpPrvGet(vfp, d, dbl), (ext & 2) ? 0 : vfpPrvGet(vfp, m, dbl), dbl, ext & 1);
+			return true;
+
+		case VFP_EXT_CVT:		//cp10: Dd = Sm, cp11: Sd = Dm
+			if(dbl ? M : D) return false;
+			if(dbl) vfpPrvSet(vfp, (CRd << 1) | D, false, vfpPrvConvert(vfp, vfpPrvGet(vfp, CRm, true), false));
+			else vfpPrvSet(vfp, CRd, true, vfpPrvConvert(vfp, vfpPrvGet(vfp, (CRm << 1) | M, false), true));
+			return true;
+
+		case VFP_EXT_UITO:		//from Sm
+		case VFP_EXT_SITO:
+			if(dbl && D) return false;
+			i = (CRm << 1) | M;
+			vfpPrvSet(vfp, d, dbl, vfpPrvFromHost(vfp, (ext & 1) ? (double)(Int32)vfp->s[i] : (double)vfp->s[i], dbl));
+			return true;
+
+		case VFP_EXT_TOUI:		//to Sd
+		case VFP_EXT_TOUIZ:
+		case VFP_EXT_TOSI:
+		case VFP_EXT_TOSIZ:
+			if(dbl && M) return false;
+			vfp->s[(CRd << 1) | D] = vfpPrvToInt(vfp, vfpPrvGet(vfp, m, dbl), dbl, (ext & 2) != 0, ext & 1);
+			return true;
+
+		case VFP_EXT_CPY:
+		case VFP_EXT_ABS:
+		case VFP_EXT_NEG:
+		case VFP_EXT_SQRT:
+			if(dbl && (D || M)) return false;
+			break;
+
+		default:
+			return false;
+	}
+	else if(opc > VFP_OP_DIV || (dbl && (D || N || M))) return false;
+
+	len = ((vfp->FPSCR >> VFP_FPSCR_LEN_SHIFT) & 7) + 1;
+	stride = ((vfp->FPSCR >> VFP_FPSCR_STRIDE_SHIFT) & 3) ? 2 : 1;
+	bank = dbl ? 4 : 8;
+
+	if(d < bank) len = 1;		//destination in the first bank: scalar
+	mVec = m >= bank;			//else Fm in the first bank is a scalar for all elements
+
+	for(i = 0; i < len; i++){
+
+		vfpPrvSet(vfp, d, dbl, vfpPrvElement(vfp, opc, ext, d, n, m, dbl));
+
+		d = (d &~ (bank - 1)) | ((d + stride) & (bank - 1));		//vectors wrap around inside their bank
+		n = (n &~ (bank - 1)) | ((n + stride) & (bank - 1));
+		if(mVec) m = (m &~ (bank - 1)) | ((m + stride) & (bank - 1));
+	}
+	return true;
+}
+
+static Boolean vfpPrvDataProcessing(ArmVfp* vfp, Boolean dbl, Boolean two, UInt8 op1, UInt8 CRd, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	UInt8 rmode = (vfp->FPSCR >> VFP_FPSCR_RMODE_SHIFT) & 3;
+	Boolean ret;
+
+	if(two || !(vfp->FPEXC & VFP_FPEXC_EN)) return false;
+
+	if(vfpPrvHostFlags() &~ vfp->FPSCR) feclearexcept(FE_ALL_EXCEPT);	//left over from before the guest cleared them (or not ours): would show up as new
+	if(rmode) fesetround(vfpPrvRound[rmode]);
+
+	ret = vfpPrvExecute(vfp, dbl, op1, CRd, CRn, CRm, op2);
+
+	if(rmode) fesetround(FE_TONEAREST);
+	return ret;
+}
+
+static Boolean vfpPrvRegXfer(struct ArmCpu* cpu, ArmVfp* vfp, Boolean dbl, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	Boolean privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
+	UInt8 r;
+	UInt32 val = 0;
+
+	if(two || CRm != 0 || (op2 & 3)) return false;
+
+	if(!dbl && op1 == 7){		//FMRX/FMXR
+
+		if(op2) return false;
+		if(!read) val = cpuGetRegExternal(cpu, Rx);
+
+		switch(CRn){
+
+			case VFP_REG_FPSID:
+				if(read) val = VFP_FPSID;		//writes are ignored
+				else if(!privileged) return false;
+				break;
+
+			case VFP_REG_FPSCR:
+				if(!(vfp->FPEXC & VFP_FPEXC_EN)) return false;
+				if(read && Rx == 15){		//FMSTAT
+
+					cpu->CPSR = (cpu->CPSR &~ VFP_FPSCR_NZCV) | (vfp->FPSCR & VFP_FPSCR_NZCV);
+					return true;
+				}
+				if(read) val = vfp->FPSCR;
+				else vfp->FPSCR = val & VFP_FPSCR_MASK;
+				break;
+
+			case VFP_REG_FPEXC:
+				if(!privileged) return false;
+				if(read) val = vfp->FPEXC;
+				else vfp->FPEXC = val & VFP_FPEXC_EN;		//we never have an exception pending
+				break;
+
+			default:
+				return false;
+		}
+		if(read) cpuSetReg(cpu, Rx, val);
+		return true;
+	}
+
+	if(!(vfp->FPEXC & VFP_FPEXC_EN)) return false;
+
+	if(dbl){		//FMDLR/FMRDL (op1 = 0) and FMDHR/FMRDH (op1 = 1)
+
+		if(op1 > 1 || op2) return false;
+		r = (CRn << 1) | op1;
+	}
+	else{			//FMSR/FMRS
+
+		if(op1) return false;
+		r = (CRn << 1) | (op2 >> 2);
+	}
+
+	if(read) cpuSetReg(cpu, Rx, vfp->s[r]);
+	else vfp->s[r] = cpuGetRegExternal(cpu, Rx);
+	return true;
+}
+
+static Boolean vfpPrvTwoReg(struct ArmCpu* cpu, ArmVfp* vfp, Boolean dbl, Boolean MRRC, UInt8 op, UInt8 Rd, UInt8 Rn, UInt8 CRm){	//FMDRR/FMRRD and FMSRR/FMRRS (Sm and Sm + 1)
+
+	UInt8 r = (CRm << 1) | ((op >> 1) & 1);
+
+	if((op & 0x0D) != 1 || (dbl && (op & 2)) || r == 31) return false;
+	if(!(vfp->FPEXC & VFP_FPEXC_EN)) return false;
+
+	if(MRRC){
+
+		cpuSetReg(cpu, Rd, vfp->s[r]);
+		cpuSetReg(cpu, Rn, vfp->s[r + 1]);
+	}
+	else{
+
+		vfp->s[r] = cpuGetRegExternal(cpu, Rd);
+		vfp->s[r + 1] = cpuGetRegExternal(cpu, Rn);
+	}
+	return true;
+}
+
+static Boolean vfpPrvMemAccess(struct ArmCpu* cpu, ArmVfp* vfp, Boolean dbl, Boolean two, Boolean D, Boolean store, UInt8 CRd, UInt32 addr, UInt8* option, UInt8 words, UInt8 adrMode){	//FLD/FST and FLDM/FSTM
+
+	UInt8 r = (CRd << 1) | (dbl ? 0 : D), n;
+
+	if(two || (dbl && D) || !(vfp->FPEXC & VFP_FPEXC_EN)) return false;
+	if((adrMode & ARM_CP_ADR_W) && !(adrMode & ARM_CP_ADR_P) == !(adrMode & ARM_CP_ADR_U)) return false;	//writeback is only IA (P=0 U=1) or DB (P=1 U=0), the other two are undefined
+
+	if(option) n = *option;			//IA, no writeback: the offset field says how many words
+	else if(words) n = words;		//IA or DB with writeback
+	else n = dbl ? 2 : 1;			//FLDS, FLDD, FSTS, FSTD
+	if(dbl) n &= ~1;			//FLDMX/FSTMX have one more word, it holds nothing for us
+
+	if(!n || r + n > 32) return false;
+
+	cpuCoprocMemAccess(cpu, vfp->s + r, addr, n, store);	//a fault is taken as an abort right there, we are done either way
+	return true;
+}
+
+static Boolean vfpPrvRegXferS(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	return vfpPrvRegXfer(cpu, userData, false, two, read, op1, Rx, CRn, CRm, op2);
+}
+
+static Boolean vfpPrvRegXferD(struct ArmCpu* cpu, void* userData, Boolean two, Boolean read, UInt8 op1, UInt8 Rx, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	return vfpPrvRegXfer(cpu, userData, true, two, read, op1, Rx, CRn, CRm, op2);
+}
+
+static Boolean vfpPrvDataProcessingS(_UNUSED_ struct ArmCpu* cpu, void* userData, Boolean two, UInt8 op1, UInt8 CRd, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	return vfpPrvDataProcessing(userData, false, two, op1, CRd, CRn, CRm, op2);
+}
+
+static Boolean vfpPrvDataProcessingD(_UNUSED_ struct ArmCpu* cpu, void* userData, Boolean two, UInt8 op1, UInt8 CRd, UInt8 CRn, UInt8 CRm, UInt8 op2){
+
+	return vfpPrvDataProcessing(userData, true, two, op1, CRd, CRn, CRm, op2);
+}
+
+static Boolean vfpPrvTwoRegS(struct ArmCpu* cpu, void* userData, Boolean MRRC, UInt8 op, UInt8 Rd, UInt8 Rn, UInt8 CRm){
+
+	return vfpPrvTwoReg(cpu, userData, false, MRRC, op, Rd, Rn, CRm);
+}
+
+static Boolean vfpPrvTwoRegD(struct ArmCpu* cpu, void* userData, Boolean MRRC, UInt8 op, UInt8 Rd, UInt8 Rn, UInt8 CRm){
+
+	return vfpPrvTwoReg(cpu, userData, true, MRRC, op, Rd, Rn, CRm);
+}
+
+static Boolean vfpPrvMemAccessS(struct ArmCpu* cpu, void* userData, Boolean two, Boolean N, Boolean store, UInt8 CRd, UInt32 addr, UInt8* option, UInt8 words, UInt8 adrMode){
+
+	return vfpPrvMemAccess(cpu, userData, false, two, N, store, CRd, addr, option, words, adrMode);
+}
+
+static Boolean vfpPrvMemAccessD(struct ArmCpu* cpu, void* userData, Boolean two, Boolean N, Boolean store, UInt8 CRd, UInt32 addr, UInt8* option, UInt8 words, UInt8 adrMode){
+
+	return vfpPrvMemAccess(cpu, userData, true, two, N, store, CRd, addr, option, words, adrMode);
+}
+
+void vfpInit(ArmVfp* vfp, ArmCpu* cpu){
+
+	ArmCoprocessor cp;
+
+	__mem_zero(vfp, sizeof(ArmVfp));
+	vfp->cpu = cpu;
+
+	cp.regXfer = vfpPrvRegXferS;
+	cp.dataProcessing = vfpPrvDataProcessingS;
+	cp.memAccess = vfpPrvMemAccessS;
+	cp.twoRegF = vfpPrvTwoRegS;
+	cp.userData = vfp;
+	cpuCoprocessorRegister(cpu, 10, &cp);
+
+	cp.regXfer = vfpPrvRegXferD;
+	cp.dataProcessing = vfpPrvDataProcessingD;
+	cp.memAccess = vfpPrvMemAccessD;
+	cp.twoRegF = vfpPrvTwoRegD;
+	cpuCoprocessorRegister(cpu, 11, &cp);
+}
+
+void vfpDeinit(ArmVfp* vfp){
+
+	cpuCoprocessorUnregister(vfp->cpu, 10);
+	cpuCoprocessorUnregister(vfp->cpu, 11);
+}
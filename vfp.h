@@ -0,0 +1,33 @@
+#ifndef _VFP_H_
+#define _VFP_H_
+
+
+#include "types.h"
+#include "CPU.h"
+
+/*
+	VFPv2 floating point: cp10 does single precision, cp11 double (host builds only)
+
+	PURRPOSE: guest floating point runs on the host's FPU instead of trapping to an emulator every op
+
+	s0..s31 are the registers, d<n> is s<2n> (low word) and s<2n+1>. ops run as host doubles (singles
+	are rounded back once, which gives the same correctly rounded result) with the host rounding mode
+	set from FPSCR, and the host's exception flags go into FPSCR's cumulative ones. NaN propagation,
+	default NaN and flush-to-zero are done ARM's way, not the host's. short vectors (FPSCR LEN/STRIDE)
+	are supported. trap enable bits are kept but never trap, as with no support code installed.
+*/
+
+typedef struct{
+
+	ArmCpu* cpu;
+
+	UInt32 s[32];
+	UInt32 FPSCR;		//status and control
+	UInt32 FPEXC;		//exception: EN gates everything but FPSID/FPEXC access
+
+}ArmVfp;
+
+void vfpInit(ArmVfp* vfp, ArmCpu* cpu);
+void vfpDeinit(ArmVfp* vfp);
+
+#endif